@@ -0,0 +1,55 @@
+//
+// Art-Net packets, ArtDmx universes are gathered into frames by UniverseFrame,
+// frames are latched by ArtSync when controller sends it, otherwise when all universes of frame arrived.
+//
+// ArtDmx: "Art-Net\0", u16 LE opcode 0x5000, u16 BE protocol version, u8 sequence, u8 physical,
+//         u8 SubUni, u8 Net (15 bit universe Net << 8 | SubUni), u16 BE data length, DMX data.
+// ArtSync: "Art-Net\0", u16 LE opcode 0x5200, u16 BE protocol version, u8 aux1, u8 aux2.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "UniverseFrame.h"
+
+namespace LedMapper {
+
+constexpr unsigned short ARTNET_PORT = 6454;
+constexpr uint16_t ARTNET_OP_DMX = 0x5000;
+constexpr uint16_t ARTNET_OP_SYNC = 0x5200;
+constexpr size_t ARTNET_HEADER_SIZE = 18; // ArtDmx header before DMX data
+constexpr size_t ARTNET_SYNC_SIZE = 14;
+
+struct ArtDmx {
+    uint16_t universe;
+    uint8_t sequence;
+    const uint8_t *data;
+    size_t length;
+};
+
+/// opcode of Art-Net packet or 0 if datagram is not Art-Net
+inline uint16_t artNetOpCode(const char *message, size_t size)
+{
+    static const char id[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+    if (size < 10 || memcmp(message, id, sizeof(id)) != 0)
+        return 0;
+    return static_cast<uint8_t>(message[8]) | static_cast<uint8_t>(message[9]) << 8;
+}
+
+/// point dmx to ArtDmx packet data, returns false if packet is malformed
+inline bool readArtDmx(const char *message, size_t size, ArtDmx &dmx)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message);
+    if (size < ARTNET_HEADER_SIZE || artNetOpCode(message, size) != ARTNET_OP_DMX)
+        return false;
+    dmx.sequence = bytes[12];
+    dmx.universe = (bytes[15] & 0x7F) << 8 | bytes[14];
+    dmx.length = bytes[16] << 8 | bytes[17];
+    dmx.data = bytes + ARTNET_HEADER_SIZE;
+    return dmx.length <= DMX_SLOTS && dmx.length <= size - ARTNET_HEADER_SIZE;
+}
+
+} // namespace LedMapper
@@ -0,0 +1,262 @@
+//
+// Logging for receive and render paths: LOG_ASYNC copies call site pointer and arguments into
+// lock-free ring of calling thread, background thread formats records and writes them through easylogging++,
+// so hot path neither takes logger mutex nor formats text. Records of one call site are rate limited.
+//
+//   LOG_ASYNC(WARNING, "Dropped malformed frame of size={}", received);
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <type_traits>
+
+#include "SpscRing.h"
+#include "easylogging++.h"
+
+namespace LedMapper {
+
+/// levels of LOG_ASYNC(LEVEL, ...) named as in LOG(LEVEL)
+constexpr el::Level ASYNC_LOG_ERROR = el::Level::Error;
+constexpr el::Level ASYNC_LOG_WARNING = el::Level::Warning;
+constexpr el::Level ASYNC_LOG_INFO = el::Level::Info;
+
+/// static state of one LOG_ASYNC call
+struct LogSite {
+    el::Level level;
+    const char *file;
+    int line;
+    const char *func;
+    const char *text; // each "{}" is replaced by next argument
+    std::atomic<int64_t> second{ 0 }; // rate limit window
+    std::atomic<uint32_t> inSecond{ 0 };
+    std::atomic<uint32_t> suppressed{ 0 };
+};
+
+/// argument copied into record: integer, floating point or string which outlives the record (literal)
+class LogArg {
+public:
+    LogArg()
+        : m_type(NONE)
+    {
+    }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    LogArg(T value)
+        : m_type(SIGNED)
+    {
+        m_value.i = value;
+    }
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, int>::type = 0>
+    LogArg(T value)
+        : m_type(UNSIGNED)
+    {
+        m_value.u = value;
+    }
+    LogArg(double value)
+        : m_type(REAL)
+    {
+        m_value.d = value;
+    }
+    LogArg(const char *value)
+        : m_type(STRING)
+    {
+        m_value.s = value;
+    }
+
+    void write(std::ostream &out) const
+    {
+        switch (m_type) {
+        case SIGNED: out << m_value.i; break;
+        case UNSIGNED: out << m_value.u; break;
+        case REAL: out << m_value.d; break;
+        case STRING: out << (m_value.s ? m_value.s : "(null)"); break;
+        case NONE: break;
+        }
+    }
+
+private:
+    enum Type : uint8_t { NONE, SIGNED, UNSIGNED, REAL, STRING };
+    Type m_type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s;
+    } m_value;
+};
+
+class AsyncLog {
+public:
+    static constexpr size_t MAX_ARGS = 4;
+    static constexpr size_t RING_RECORDS = 256; // per producer thread, records are dropped when it is full
+    static constexpr size_t MAX_THREADS = 4; // with own ring, further threads log synchronously
+    static constexpr uint32_t SITE_RECORDS_PER_SECOND = 10; // rest are counted and reported with next one
+    static constexpr int DRAIN_PERIOD_MS = 10; // delay of records from hot path
+
+    struct Record {
+        const LogSite *site;
+        uint32_t suppressed;
+        LogArg args[MAX_ARGS];
+    };
+
+    static AsyncLog &instance()
+    {
+        static AsyncLog log;
+        return log;
+    }
+
+    ~AsyncLog() { stop(); }
+
+    AsyncLog(const AsyncLog &) = delete;
+    AsyncLog &operator=(const AsyncLog &) = delete;
+
+    /// start formatting thread, records are written synchronously before start() and after stop()
+    void start()
+    {
+        if (m_running.exchange(true))
+            return;
+        m_writer = std::thread([this]() {
+            const std::chrono::milliseconds period(int{ DRAIN_PERIOD_MS });
+            while (m_running.load(std::memory_order_acquire)) {
+                drain();
+                std::this_thread::sleep_for(period);
+            }
+        });
+    }
+
+    /// stop formatting thread and write what is left in rings
+    void stop()
+    {
+        if (!m_running.exchange(false))
+            return;
+        if (m_writer.joinable())
+            m_writer.join();
+        drain();
+    }
+
+    template <typename... Args>
+    void push(LogSite &site, const Args &... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "LOG_ASYNC takes up to AsyncLog::MAX_ARGS arguments");
+        uint32_t suppressed;
+        if (!admit(site, suppressed))
+            return;
+        if (!m_running.load(std::memory_order_acquire)) {
+            Record record{ &site, suppressed, { LogArg(args)... } };
+            write(record);
+            return;
+        }
+        Ring *ring = threadRing();
+        if (!ring) {
+            Record record{ &site, suppressed, { LogArg(args)... } };
+            write(record);
+            return;
+        }
+        Record *record = ring->producerSlot();
+        if (!record) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        *record = Record{ &site, suppressed, { LogArg(args)... } };
+        ring->publish();
+    }
+
+private:
+    using Ring = SpscRing<Record, RING_RECORDS>;
+
+    AsyncLog()
+        : m_running(false)
+        , m_dropped(0)
+        , m_threads(0)
+    {
+    }
+
+    /// rate limit per site, window is one second of coarse monotonic clock which is read without syscall
+    static bool admit(LogSite &site, uint32_t &suppressed)
+    {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+        if (site.second.load(std::memory_order_relaxed) != now.tv_sec) {
+            site.second.store(now.tv_sec, std::memory_order_relaxed);
+            site.inSecond.store(0, std::memory_order_relaxed);
+        }
+        if (site.inSecond.fetch_add(1, std::memory_order_relaxed) >= SITE_RECORDS_PER_SECOND) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// ring of calling thread taken on its first record, nullptr if all are taken
+    Ring *threadRing()
+    {
+        thread_local Ring *ring = nullptr;
+        thread_local bool assigned = false;
+        if (!assigned) {
+            assigned = true;
+            const size_t index = m_threads.fetch_add(1, std::memory_order_acq_rel);
+            if (index < MAX_THREADS)
+                ring = &m_rings[index];
+        }
+        return ring;
+    }
+
+    void drain()
+    {
+        size_t threads = m_threads.load(std::memory_order_acquire);
+        if (threads > MAX_THREADS)
+            threads = MAX_THREADS;
+        for (size_t i = 0; i < threads; ++i) {
+            while (Record *record = m_rings[i].consumerSlot()) {
+                write(*record);
+                m_rings[i].release();
+            }
+        }
+        if (uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed))
+            LOG(WARNING) << "Async log dropped records=" << dropped << " on full ring";
+    }
+
+    static void write(const Record &record)
+    {
+        const LogSite &site = *record.site;
+        std::ostringstream text;
+        size_t arg = 0;
+        for (const char *c = site.text; *c; ++c) {
+            if (c[0] == '{' && c[1] == '}' && arg < MAX_ARGS) {
+                record.args[arg++].write(text);
+                ++c;
+            }
+            else {
+                text << *c;
+            }
+        }
+        if (record.suppressed)
+            text << " (" << record.suppressed << " more suppressed)";
+        el::base::Writer(site.level, site.file, site.line, site.func).construct(1, el::base::consts::kDefaultLoggerId)
+            << text.str();
+    }
+
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<size_t> m_threads; // which took ring
+    std::thread m_writer;
+    std::array<Ring, MAX_THREADS> m_rings;
+};
+
+} // namespace LedMapper
+
+/// LOG_ASYNC(LEVEL, text, args...): ERROR, WARNING or INFO, up to 4 args of integer, floating point or literal
+#define LOG_ASYNC(LEVEL, text, ...)                                                                                   \
+    do {                                                                                                              \
+        static LedMapper::LogSite lmLogSite{ LedMapper::ASYNC_LOG_##LEVEL, __FILE__, __LINE__, ELPP_FUNC, text };     \
+        LedMapper::AsyncLog::instance().push(lmLogSite, ##__VA_ARGS__);                                               \
+    } while (0)
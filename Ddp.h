@@ -0,0 +1,57 @@
+//
+// DDP (Distributed Display Protocol) packets. Payload is written at byte offset of contiguous pixel data
+// of display, packet with push flag ends frame, so frame is latched exactly once however it was split.
+//
+// Header, all fields big-endian:
+//   u8 flags (version in bits 7-6, timecode 0x10, storage 0x08, reply 0x04, query 0x02, push 0x01),
+//   u8 sequence (low 4 bits), u8 data type, u8 destination id, u32 data offset, u16 data length,
+//   u32 timecode if flagged, data.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LedMapper {
+
+constexpr unsigned short DDP_PORT = 4048;
+constexpr size_t DDP_HEADER_SIZE = 10;
+constexpr size_t DDP_TIMECODE_SIZE = 4;
+constexpr uint8_t DDP_VERSION_MASK = 0xC0;
+constexpr uint8_t DDP_VERSION_1 = 0x40;
+constexpr uint8_t DDP_FLAG_TIMECODE = 0x10;
+constexpr uint8_t DDP_FLAG_QUERY = 0x02;
+constexpr uint8_t DDP_FLAG_PUSH = 0x01;
+constexpr uint8_t DDP_ID_DISPLAY = 1;
+constexpr uint8_t DDP_ID_ALL = 255;
+
+struct DdpPacket {
+    uint8_t flags;
+    uint8_t dataType;
+    uint8_t destination;
+    uint32_t offset;
+    const uint8_t *data;
+    size_t length;
+};
+
+/// pixel data types senders use for RGB 8 bit: undefined, "RGB" without size and RGB 8 bit per channel
+inline bool isDdpRgb24(uint8_t dataType) { return dataType == 0x00 || dataType == 0x01 || dataType == 0x0B; }
+
+/// point packet to DDP header fields and data, returns false if datagram is not valid DDP v1
+inline bool readDdp(const char *message, size_t size, DdpPacket &packet)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message);
+    if (size < DDP_HEADER_SIZE || (bytes[0] & DDP_VERSION_MASK) != DDP_VERSION_1)
+        return false;
+    packet.flags = bytes[0];
+    packet.dataType = bytes[2];
+    packet.destination = bytes[3];
+    packet.offset = uint32_t(bytes[4]) << 24 | bytes[5] << 16 | bytes[6] << 8 | bytes[7];
+    packet.length = bytes[8] << 8 | bytes[9];
+    const size_t header = DDP_HEADER_SIZE + (packet.flags & DDP_FLAG_TIMECODE ? DDP_TIMECODE_SIZE : 0);
+    packet.data = bytes + header;
+    return size >= header && packet.length <= size - header;
+}
+
+} // namespace LedMapper
@@ -0,0 +1,175 @@
+//
+// epoll based reactor: waits on sockets, signals and timers in one place
+// and dispatches ready descriptors to handlers on the calling thread
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+#include "easylogging++.h"
+
+namespace LedMapper {
+
+class EventLoop {
+public:
+    using Handler = std::function<void()>;
+    using SignalHandler = std::function<void(int)>;
+    using TimerHandler = std::function<void(uint64_t)>;
+
+    EventLoop()
+        : m_epollFd(epoll_create1(EPOLL_CLOEXEC))
+        , m_running(false)
+        , m_dispatching(false)
+    {
+        if (m_epollFd < 0)
+            LOG(ERROR) << "epoll_create1 failed: " << errno << "-" << strerror(errno);
+    }
+
+    ~EventLoop()
+    {
+        for (auto fd : m_ownedFds)
+            close(fd);
+        if (m_epollFd >= 0)
+            close(m_epollFd);
+    }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    bool isValid() const { return m_epollFd >= 0; }
+
+    /// call handler each time fd becomes readable (level triggered)
+    bool add(int fd, Handler handler)
+    {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            LOG(ERROR) << "epoll_ctl add fd=" << fd << " failed: " << errno << "-" << strerror(errno);
+            return false;
+        }
+        /// fd number of descriptor removed earlier in this dispatch round may be reused already
+        m_removed.erase(std::remove(m_removed.begin(), m_removed.end(), fd), m_removed.end());
+        m_handlers[fd] = std::move(handler);
+        return true;
+    }
+
+    /// handlers may remove own fd, handler is destroyed after current dispatch round then
+    bool remove(int fd)
+    {
+        if (m_dispatching)
+            m_removed.push_back(fd);
+        else
+            m_handlers.erase(fd);
+        return epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr) == 0;
+    }
+
+    /// block signals for this and all threads spawned afterwards and receive them through signalfd,
+    /// so must be called before any other thread is started
+    bool addSignals(std::initializer_list<int> signals, SignalHandler handler)
+    {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (auto sig : signals)
+            sigaddset(&mask, sig);
+        if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+            LOG(ERROR) << "pthread_sigmask failed";
+            return false;
+        }
+        int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (fd < 0) {
+            LOG(ERROR) << "signalfd failed: " << errno << "-" << strerror(errno);
+            return false;
+        }
+        m_ownedFds.push_back(fd);
+        return add(fd, [fd, handler]() {
+            signalfd_siginfo info;
+            while (read(fd, &info, sizeof(info)) == sizeof(info))
+                handler(static_cast<int>(info.ssi_signo));
+        });
+    }
+
+    /// periodic timer, handler gets number of expirations since last call,
+    /// returns timer fd or -1 on failure
+    int addTimer(std::chrono::microseconds period, TimerHandler handler)
+    {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            LOG(ERROR) << "timerfd_create failed: " << errno << "-" << strerror(errno);
+            return -1;
+        }
+        itimerspec spec;
+        spec.it_interval.tv_sec = period.count() / 1000000;
+        spec.it_interval.tv_nsec = (period.count() % 1000000) * 1000;
+        spec.it_value = spec.it_interval;
+        if (timerfd_settime(fd, 0, &spec, nullptr) != 0) {
+            LOG(ERROR) << "timerfd_settime failed: " << errno << "-" << strerror(errno);
+            close(fd);
+            return -1;
+        }
+        m_ownedFds.push_back(fd);
+        if (!add(fd, [fd, handler]() {
+                uint64_t expirations = 0;
+                if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+                    handler(expirations);
+            }))
+            return -1;
+        return fd;
+    }
+
+    /// dispatch events until stop() is called from one of the handlers
+    void run()
+    {
+        epoll_event events[MAX_EVENTS];
+        m_running = true;
+        while (m_running) {
+            int ready = epoll_wait(m_epollFd, events, MAX_EVENTS, -1);
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                LOG(ERROR) << "epoll_wait failed: " << errno << "-" << strerror(errno);
+                break;
+            }
+            m_dispatching = true;
+            for (int i = 0; i < ready && m_running; ++i) {
+                if (std::find(m_removed.begin(), m_removed.end(), events[i].data.fd) != m_removed.end())
+                    continue;
+                auto handler = m_handlers.find(events[i].data.fd);
+                if (handler != m_handlers.end())
+                    handler->second();
+            }
+            m_dispatching = false;
+            for (auto fd : m_removed)
+                m_handlers.erase(fd);
+            m_removed.clear();
+        }
+    }
+
+    void stop() { m_running = false; }
+
+private:
+    static constexpr int MAX_EVENTS = 16;
+
+    int m_epollFd;
+    bool m_running;
+    bool m_dispatching;
+    std::map<int, Handler> m_handlers;
+    std::vector<int> m_removed; // during dispatch
+    std::vector<int> m_ownedFds;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,250 @@
+//
+// Bookkeeping for reassembly of fragmented frames (see FrameProtocol.h).
+// Pool of PoolSize preallocated entries, each entry stands for one producer slot of frame mailbox,
+// so fragment payloads are converted straight into output buffers of that slot.
+// Parity is kept as running XOR per group, so lost fragment is rebuilt without storing received ones.
+// Used from event loop thread only.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "FrameProtocol.h"
+
+namespace LedMapper {
+
+/// fragment rebuilt from XOR parity, payload points into assembler memory valid until next add()
+struct RecoveredFragment {
+    uint32_t byteOffset;
+    const uint8_t *payload;
+    size_t size;
+};
+
+template <size_t PoolSize>
+class FrameAssembler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// parityBytes is size of parity accumulator of each entry, frames with parity needing more
+    /// are still reassembled, only without recovery
+    FrameAssembler(Clock::duration timeout, size_t parityBytes)
+        : m_timeout(timeout)
+        , m_dropped(0)
+        , m_recovered(0)
+    {
+        for (auto &entry : m_entries) {
+            entry.state = FREE;
+            entry.parity.resize(parityBytes);
+        }
+    }
+
+    /// find or start reassembly of fragment's frame and account data or parity fragment in it,
+    /// returns pool slot to write data fragment payload into or -1 if fragment is duplicate, belongs
+    /// to already completed frame or doesn't match its frame. If pool is full oldest incomplete frame is dropped
+    int add(const FragmentHeader &header, const uint8_t *payload, size_t payloadSize, Clock::time_point now)
+    {
+        int slot = find(header.frameId);
+        if (slot >= 0 && m_entries[slot].state == DONE)
+            return -1;
+        if (slot < 0) {
+            slot = allocate();
+            Entry &entry = m_entries[slot];
+            entry.state = ASSEMBLING;
+            entry.frameId = header.frameId;
+            entry.fragCount = header.fragCount;
+            entry.parityGroup = header.parityGroup;
+            entry.frameBytes = header.frameBytes;
+            entry.fragBytes = 0;
+            entry.missing = header.fragCount;
+            entry.received = 0;
+            entry.parityReceived = 0;
+            entry.parityStarted = 0;
+            entry.useParity = false;
+            entry.started = now;
+        }
+
+        Entry &entry = m_entries[slot];
+        if (entry.fragCount != header.fragCount || entry.frameBytes != header.frameBytes
+            || entry.parityGroup != header.parityGroup)
+            return -1;
+
+        /// all data fragments but last are fragBytes long, learn it from first fragment seen
+        const uint32_t fragBytes = fullFragmentBytes(header, payloadSize);
+        if (fragBytes == 0)
+            return -1;
+        if (entry.fragBytes == 0) {
+            entry.fragBytes = fragBytes;
+            entry.useParity = entry.parityGroup > 0
+                              && parityFragments(header) * fragBytes <= entry.parity.size();
+        }
+        else if (entry.fragBytes != fragBytes)
+            return -1;
+
+        if (isParity(header)) {
+            const size_t group = header.fragIndex - header.fragCount;
+            const uint64_t bit = uint64_t(1) << group;
+            if (!entry.useParity || (entry.parityReceived & bit)
+                || header.byteOffset != group * entry.parityGroup * entry.fragBytes)
+                return -1;
+            entry.parityReceived |= bit;
+            accumulate(entry, group, payload, payloadSize);
+            entry.lastGroup = group;
+            return slot;
+        }
+
+        const uint64_t bit = uint64_t(1) << header.fragIndex;
+        if ((entry.received & bit) || header.byteOffset != header.fragIndex * entry.fragBytes)
+            return -1;
+        entry.received |= bit;
+        --entry.missing;
+        if (entry.useParity) {
+            entry.lastGroup = header.fragIndex / entry.parityGroup;
+            accumulate(entry, entry.lastGroup, payload, payloadSize);
+        }
+        return slot;
+    }
+
+    /// rebuild data fragment if group of fragment just added lacks only one and its parity is here,
+    /// recovered fragment is accounted as received
+    bool recover(int slot, RecoveredFragment &fragment)
+    {
+        Entry &entry = m_entries[slot];
+        const size_t group = entry.lastGroup;
+        if (!entry.useParity || !(entry.parityReceived & (uint64_t(1) << group)))
+            return false;
+
+        const size_t first = group * entry.parityGroup;
+        const size_t count = std::min<size_t>(entry.parityGroup, entry.fragCount - first);
+        const uint64_t lost = groupMask(first, count) & ~entry.received;
+        if (lost == 0 || (lost & (lost - 1)) != 0)
+            return false;
+
+        const size_t index = __builtin_ctzll(lost);
+        fragment.byteOffset = index * entry.fragBytes;
+        fragment.payload = entry.parity.data() + group * entry.fragBytes;
+        fragment.size = std::min<size_t>(entry.fragBytes, entry.frameBytes - fragment.byteOffset);
+        entry.received |= lost;
+        --entry.missing;
+        ++m_recovered;
+        return true;
+    }
+
+    bool isComplete(int slot) const { return m_entries[slot].missing == 0; }
+
+    /// mark frame done after it was published, its late fragments are ignored until slot is reused
+    void release(int slot) { m_entries[slot].state = DONE; }
+
+    /// drop incomplete frames started more than timeout ago, returns number of dropped frames
+    size_t expire(Clock::time_point now)
+    {
+        size_t expired = 0;
+        for (auto &entry : m_entries) {
+            if (entry.state == ASSEMBLING && now - entry.started > m_timeout) {
+                entry.state = FREE;
+                ++expired;
+            }
+        }
+        m_dropped += expired;
+        return expired;
+    }
+
+    /// incomplete frames dropped by timeout or eviction
+    size_t dropped() const { return m_dropped; }
+
+    /// data fragments rebuilt from parity
+    size_t recovered() const { return m_recovered; }
+
+    static constexpr size_t size() { return PoolSize; }
+
+private:
+    enum State : uint8_t { FREE, ASSEMBLING, DONE };
+
+    struct Entry {
+        State state;
+        bool useParity;
+        uint32_t frameId;
+        uint8_t fragCount;
+        uint8_t missing;
+        uint8_t parityGroup;
+        uint8_t lastGroup; // parity group touched by last add()
+        uint32_t frameBytes;
+        uint32_t fragBytes;
+        uint64_t received; // bit per data fragment index
+        uint64_t parityReceived; // bit per parity group
+        uint64_t parityStarted; // bit per parity group with initialized accumulator
+        Clock::time_point started;
+        std::vector<uint8_t> parity; // XOR accumulator of fragBytes per parity group
+    };
+
+    /// size of full data fragment of frame derived from any of its fragments, 0 if it can't be
+    static uint32_t fullFragmentBytes(const FragmentHeader &header, size_t payloadSize)
+    {
+        if (isParity(header) || header.fragIndex + 1 < header.fragCount || header.fragIndex == 0)
+            return payloadSize;
+        /// last fragment may be shorter, but all fragments before it are full
+        return header.byteOffset % header.fragIndex == 0 ? header.byteOffset / header.fragIndex : 0;
+    }
+
+    static uint64_t groupMask(size_t first, size_t count)
+    {
+        return (count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << first;
+    }
+
+    /// XOR payload zero padded to fragBytes into accumulator of group, first payload is copied
+    static void accumulate(Entry &entry, size_t group, const uint8_t *payload, size_t payloadSize)
+    {
+        uint8_t *acc = entry.parity.data() + group * entry.fragBytes;
+        const uint64_t bit = uint64_t(1) << group;
+        payloadSize = std::min<size_t>(payloadSize, entry.fragBytes);
+        if (!(entry.parityStarted & bit)) {
+            memcpy(acc, payload, payloadSize);
+            memset(acc + payloadSize, 0, entry.fragBytes - payloadSize);
+            entry.parityStarted |= bit;
+            return;
+        }
+        for (size_t i = 0; i < payloadSize; ++i)
+            acc[i] ^= payload[i];
+    }
+
+    int find(uint32_t frameId) const
+    {
+        for (size_t i = 0; i < PoolSize; ++i) {
+            if (m_entries[i].state != FREE && m_entries[i].frameId == frameId)
+                return i;
+        }
+        return -1;
+    }
+
+    /// prefer free entry, then oldest completed one, evict oldest incomplete frame only if pool is full of them
+    int allocate()
+    {
+        int oldestDone = -1, oldest = 0;
+        for (size_t i = 0; i < PoolSize; ++i) {
+            const Entry &entry = m_entries[i];
+            if (entry.state == FREE)
+                return i;
+            if (entry.state == DONE && (oldestDone < 0 || entry.started < m_entries[oldestDone].started))
+                oldestDone = i;
+            if (entry.started < m_entries[oldest].started)
+                oldest = i;
+        }
+        if (oldestDone >= 0)
+            return oldestDone;
+        ++m_dropped;
+        return oldest;
+    }
+
+    std::array<Entry, PoolSize> m_entries;
+    Clock::duration m_timeout;
+    size_t m_dropped;
+    size_t m_recovered;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,124 @@
+//
+// lmListener frame protocol.
+//
+// Legacy frame, one datagram:
+//   u16 leds in channel 0, u16 leds in channel 1, ..., 0xFF 0xFF, RGB pixels of all channels
+//
+// Fragmented frame, pixels of one frame split over several datagrams kept under MTU,
+// every datagram is FragmentHeader followed by payload:
+//   payload is frameBytes long RGB pixels of all channels sliced at byteOffset,
+//   fragments carry whole pixels, so byteOffset and payload size are multiples of 3
+//   (payload of last fragment may be shorter than others).
+// Optional XOR parity, enabled by parityGroup > 0:
+//   data fragments are split into groups of parityGroup consecutive fragments, parity fragment of group g
+//   has fragIndex fragCount + g, byteOffset of group's first fragment and payload of all group's payloads
+//   XORed together, each zero padded to size of full fragment. Any one lost data fragment of group
+//   is rebuilt from parity and the rest of group.
+// Sequenced frame, version 2: same as fragmented frame, frameId is sequence number growing by one
+//   per frame and wrapping around, receiver drops frames older than last shown one.
+// Fixed header frame, version 3, one datagram:
+//   FrameHeader followed by pixels of all channels in pixelFormat, datagram must hold all of them.
+//   sequence is ordered as frameId of version 2.
+// All fields are little-endian. Magic "LM" read as legacy header would be 19788 leds,
+// which is more than any channel holds, so legacy and "LM" frames are told apart by first two bytes,
+// versions by third one.
+//
+
+#pragma once
+
+#include <endian.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace LedMapper {
+
+constexpr uint8_t FRAME_MAGIC_0 = 'L';
+constexpr uint8_t FRAME_MAGIC_1 = 'M';
+constexpr uint8_t FRAME_VERSION_FRAGMENTED = 1;
+constexpr uint8_t FRAME_VERSION_SEQUENCED = 2;
+constexpr uint8_t FRAME_VERSION_FIXED = 3;
+constexpr size_t FRAME_MAX_CHANNELS = 8;
+constexpr size_t FRAME_MAX_FRAGMENTS = 64;
+constexpr size_t FRAGMENT_HEADER_CHANNELS = 2;
+
+struct FragmentHeader {
+    uint8_t magic[2];
+    uint8_t version;
+    uint8_t flags;
+    uint32_t frameId; // same for all fragments of frame, differs between consecutive frames, sequence in version 2
+    uint8_t fragIndex;
+    uint8_t fragCount;
+    uint8_t parityGroup; // data fragments per parity fragment, 0 if frame has no parity
+    uint8_t reserved;
+    uint32_t byteOffset; // offset of payload in frame pixels
+    uint32_t frameBytes; // size of all pixels of frame
+    uint16_t ledsInChannel[FRAGMENT_HEADER_CHANNELS];
+} __attribute__((packed));
+
+static_assert(sizeof(FragmentHeader) == 24, "FragmentHeader layout is part of protocol");
+
+enum PixelFormat : uint8_t { PIXEL_FORMAT_RGB24 = 0 };
+
+struct FrameHeader {
+    uint8_t magic[2];
+    uint8_t version;
+    uint8_t flags;
+    uint32_t sequence;
+    uint8_t channels; // used entries of ledsInChannel
+    uint8_t pixelFormat; // PixelFormat
+    uint16_t reserved;
+    uint16_t ledsInChannel[FRAME_MAX_CHANNELS];
+} __attribute__((packed));
+
+static_assert(sizeof(FrameHeader) == 28, "FrameHeader layout is part of protocol");
+
+inline bool hasFrameMagic(const char *message, size_t size)
+{
+    return size >= 3 && static_cast<uint8_t>(message[0]) == FRAME_MAGIC_0
+           && static_cast<uint8_t>(message[1]) == FRAME_MAGIC_1;
+}
+
+inline bool isFragment(const char *message, size_t size)
+{
+    return size >= sizeof(FragmentHeader) && hasFrameMagic(message, size)
+           && (static_cast<uint8_t>(message[2]) == FRAME_VERSION_FRAGMENTED
+               || static_cast<uint8_t>(message[2]) == FRAME_VERSION_SEQUENCED);
+}
+
+/// number of parity fragments sent after fragCount data fragments
+inline size_t parityFragments(const FragmentHeader &header)
+{
+    return header.parityGroup ? (header.fragCount + header.parityGroup - 1) / header.parityGroup : 0;
+}
+
+inline bool isParity(const FragmentHeader &header) { return header.fragIndex >= header.fragCount; }
+
+inline bool hasSequence(const FragmentHeader &header) { return header.version >= FRAME_VERSION_SEQUENCED; }
+
+/// copy header out of datagram converting it to host byte order,
+/// returns false if header is not consistent with datagram size
+inline bool readFragmentHeader(const char *message, size_t size, FragmentHeader &header)
+{
+    if (!isFragment(message, size))
+        return false;
+    memcpy(&header, message, sizeof(header));
+    header.frameId = le32toh(header.frameId);
+    header.byteOffset = le32toh(header.byteOffset);
+    header.frameBytes = le32toh(header.frameBytes);
+    for (size_t chan = 0; chan < FRAGMENT_HEADER_CHANNELS; ++chan)
+        header.ledsInChannel[chan] = le16toh(header.ledsInChannel[chan]);
+
+    const size_t payload = size - sizeof(FragmentHeader);
+    if (header.version < FRAME_VERSION_FRAGMENTED || header.version > FRAME_VERSION_SEQUENCED
+        || header.fragCount == 0 || header.fragCount > FRAME_MAX_FRAGMENTS
+        || header.fragIndex >= header.fragCount + parityFragments(header) || header.byteOffset % 3 != 0
+        || payload % 3 != 0)
+        return false;
+    /// parity payload is as long as full fragment, so it may pass frame end when group ends with short fragment
+    if (isParity(header))
+        return payload > 0 && header.byteOffset < header.frameBytes;
+    return static_cast<uint64_t>(header.byteOffset) + payload <= header.frameBytes;
+}
+
+} // namespace LedMapper
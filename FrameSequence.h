@@ -0,0 +1,89 @@
+//
+// Ordering of sequenced frames (see FrameProtocol.h, version 2): frame ids grow by one per frame
+// and wrap around, frames not newer than last published one are late and dropped,
+// gaps between published frames are counted as lost.
+// Used from event loop thread only.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LedMapper {
+
+/// true if sequence a was sent after b, valid while they are less than 2^31 apart
+inline bool sequenceNewer(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) > 0; }
+
+class FrameSequence {
+public:
+    /// resyncAfter late frames in a row, with no newer frame between them, are taken as sender restart
+    explicit FrameSequence(size_t resyncAfter)
+        : m_resyncAfter(resyncAfter)
+        , m_started(false)
+        , m_last(0)
+        , m_lastLate(0)
+        , m_lateInRow(0)
+        , m_late(0)
+        , m_lost(0)
+        , m_skipped(0)
+    {
+    }
+
+    /// false if frame is late: duplicate of published frame or older than it,
+    /// each late frame is counted once however many of its fragments are checked
+    bool accept(uint32_t sequence)
+    {
+        if (!m_started || sequenceNewer(sequence, m_last))
+            return true;
+        if (m_late == 0 || sequence != m_lastLate) {
+            m_lastLate = sequence;
+            ++m_late;
+            if (++m_lateInRow >= m_resyncAfter) {
+                m_started = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// account frame received but replaced by newer one before output, sequence must be accepted just before,
+    /// so the gap it leaves before next published frame is not counted as lost
+    void skipped(uint32_t sequence)
+    {
+        if (!m_started || sequenceNewer(sequence, m_last))
+            ++m_skipped;
+    }
+
+    /// account frame handed to output, sequence must be accepted just before
+    void published(uint32_t sequence)
+    {
+        if (m_started && sequenceNewer(sequence, m_last)) {
+            const uint32_t gap = sequence - m_last - 1;
+            m_lost += gap - std::min<size_t>(gap, m_skipped);
+        }
+        m_started = true;
+        m_last = sequence;
+        m_lateInRow = 0;
+        m_skipped = 0;
+    }
+
+    /// late frames dropped
+    size_t late() const { return m_late; }
+
+    /// frames never published between published ones: lost on network or dropped in reassembly
+    size_t lost() const { return m_lost; }
+
+private:
+    size_t m_resyncAfter;
+    bool m_started;
+    uint32_t m_last;
+    uint32_t m_lastLate;
+    size_t m_lateInRow;
+    size_t m_late;
+    size_t m_lost;
+    size_t m_skipped; // since last published
+};
+
+} // namespace LedMapper
@@ -0,0 +1,138 @@
+//
+// Per-thread ring of complete (begin, end) trace events, preallocated and written without locks,
+// dumped as Chrome trace JSON which chrome://tracing and Perfetto UI open.
+// Ring keeps the newest events, oldest ones are overwritten.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace LedMapper {
+
+using TraceClock = std::chrono::steady_clock;
+
+struct TraceEvent {
+    const char *name; // string literal, written to JSON as is
+    int64_t begin; // ns of TraceClock
+    int64_t end;
+    uint32_t arg;
+};
+
+class TraceRing {
+public:
+    /// ring of zero capacity is disabled and records nothing
+    TraceRing(const char *thread, size_t capacity)
+        : m_thread(thread)
+        , m_events(capacity)
+        , m_head(0)
+    {
+    }
+
+    TraceRing(const TraceRing &) = delete;
+    TraceRing &operator=(const TraceRing &) = delete;
+
+    bool enabled() const { return !m_events.empty(); }
+    const char *thread() const { return m_thread; }
+
+    /// called only by owning thread
+    void record(const char *name, TraceClock::time_point begin, TraceClock::time_point end, uint32_t arg = 0)
+    {
+        if (m_events.empty())
+            return;
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        TraceEvent &event = m_events[head % m_events.size()];
+        event.name = name;
+        event.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count();
+        event.end = std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count();
+        event.arg = arg;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    /// copy of events from any thread, events owner overwrote during copy are left out
+    std::vector<TraceEvent> events() const
+    {
+        const uint64_t capacity = m_events.size();
+        const uint64_t head = m_head.load(std::memory_order_acquire);
+        uint64_t first = head > capacity ? head - capacity : 0;
+        std::vector<TraceEvent> copy;
+        copy.reserve(head - first);
+        for (uint64_t i = first; i < head; ++i)
+            copy.push_back(m_events[i % capacity]);
+        /// owner may be writing event after newest, which takes slot of oldest
+        const uint64_t reused = m_head.load(std::memory_order_acquire) + 1;
+        if (reused > capacity && reused - capacity > first) {
+            const uint64_t overwritten = std::min<uint64_t>(reused - capacity - first, copy.size());
+            copy.erase(copy.begin(), copy.begin() + overwritten);
+        }
+        return copy;
+    }
+
+private:
+    const char *m_thread;
+    std::vector<TraceEvent> m_events;
+    std::atomic<uint64_t> m_head; // events ever recorded
+};
+
+/// records event from construction to destruction, costs one branch when ring is disabled
+class TraceScope {
+public:
+    TraceScope(TraceRing &ring, const char *name, uint32_t arg = 0)
+        : arg(arg)
+        , m_ring(ring)
+        , m_name(name)
+    {
+        if (m_ring.enabled())
+            m_begin = TraceClock::now();
+    }
+
+    ~TraceScope()
+    {
+        if (m_ring.enabled())
+            m_ring.record(m_name, m_begin, TraceClock::now(), arg);
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    uint32_t arg; // may be set before scope ends, e.g. to number of received datagrams
+
+private:
+    TraceRing &m_ring;
+    const char *m_name;
+    TraceClock::time_point m_begin;
+};
+
+/// Chrome trace event format, one tid per ring, times in us
+inline void writeChromeTrace(std::ostream &out, std::initializer_list<const TraceRing *> rings)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    int tid = 0;
+    for (const TraceRing *ring : rings) {
+        ++tid;
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"" << ring->thread() << "\"}}";
+        first = false;
+        for (const TraceEvent &event : ring->events())
+            out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << event.begin / 1e3 << ",\"dur\":" << (event.end - event.begin) / 1e3
+                << ",\"args\":{\"arg\":" << event.arg << "}}";
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace LedMapper
@@ -0,0 +1,123 @@
+//
+// Zero-copy view of single datagram frame (see FrameProtocol.h): legacy or fixed header one.
+// Datagram bounds are validated once in parse(), afterwards channel spans are plain pointers into it.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FrameProtocol.h"
+
+namespace LedMapper {
+
+/// RGB24 pixels of one channel inside datagram
+struct PixelSpan {
+    const uint8_t *rgb;
+    size_t count;
+};
+
+class FrameView {
+public:
+    FrameView()
+        : m_channels(0)
+        , m_hasSequence(false)
+        , m_sequence(0)
+        , m_pixels(nullptr)
+        , m_pixelCount(0)
+    {
+    }
+
+    /// point view to datagram, returns false if it is neither valid legacy nor fixed header frame.
+    /// Legacy frames may hold less pixels than their header declares, missing ones are cut from channel spans,
+    /// fixed header frames must hold all of them
+    bool parse(const char *message, size_t size)
+    {
+        m_channels = 0;
+        m_hasSequence = false;
+        if (hasFrameMagic(message, size))
+            return static_cast<uint8_t>(message[2]) == FRAME_VERSION_FIXED && parseFixed(message, size);
+        return parseLegacy(message, size);
+    }
+
+    size_t channels() const { return m_channels; }
+
+    /// leds count declared by header
+    uint16_t ledsInChannel(size_t chan) const { return m_leds[chan]; }
+
+    /// pixels of channel present in datagram, chan must be less than channels()
+    PixelSpan channel(size_t chan) const
+    {
+        const size_t first = std::min(m_firstPixel[chan], m_pixelCount);
+        return { m_pixels + first * 3, std::min<size_t>(m_leds[chan], m_pixelCount - first) };
+    }
+
+    bool hasSequence() const { return m_hasSequence; }
+    uint32_t sequence() const { return m_sequence; }
+
+private:
+    /// u16 leds per channel terminated by 0xFF 0xFF, terminator must be within FRAME_MAX_CHANNELS entries
+    bool parseLegacy(const char *message, size_t size)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message);
+        size_t chan, totalLeds = 0;
+        uint16_t leds;
+
+        for (chan = 0; (chan + 1) * 2 <= size; ++chan) {
+            leds = bytes[chan * 2] | bytes[chan * 2 + 1] << 8;
+            if (leds == 0xFFFF)
+                break;
+            if (chan == FRAME_MAX_CHANNELS)
+                return false;
+            m_leds[chan] = leds;
+            m_firstPixel[chan] = totalLeds;
+            totalLeds += leds;
+        }
+        if ((chan + 1) * 2 > size)
+            return false;
+
+        m_channels = chan;
+        m_pixels = bytes + (chan + 1) * 2;
+        m_pixelCount = std::min(totalLeds, (size - (chan + 1) * 2) / 3);
+        return true;
+    }
+
+    bool parseFixed(const char *message, size_t size)
+    {
+        FrameHeader header;
+        size_t chan, totalLeds = 0;
+
+        if (size < sizeof(header))
+            return false;
+        memcpy(&header, message, sizeof(header));
+        if (header.channels > FRAME_MAX_CHANNELS || header.pixelFormat != PIXEL_FORMAT_RGB24)
+            return false;
+
+        for (chan = 0; chan < header.channels; ++chan) {
+            m_leds[chan] = le16toh(header.ledsInChannel[chan]);
+            m_firstPixel[chan] = totalLeds;
+            totalLeds += m_leds[chan];
+        }
+        if (size - sizeof(header) < totalLeds * 3)
+            return false;
+
+        m_channels = header.channels;
+        m_hasSequence = true;
+        m_sequence = le32toh(header.sequence);
+        m_pixels = reinterpret_cast<const uint8_t *>(message) + sizeof(header);
+        m_pixelCount = totalLeds;
+        return true;
+    }
+
+    size_t m_channels;
+    bool m_hasSequence;
+    uint32_t m_sequence;
+    const uint8_t *m_pixels;
+    size_t m_pixelCount;
+    uint16_t m_leds[FRAME_MAX_CHANNELS];
+    size_t m_firstPixel[FRAME_MAX_CHANNELS];
+};
+
+} // namespace LedMapper
@@ -0,0 +1,134 @@
+//
+// Log-linear (HDR style) latency histogram: exact below 32 us, 16 sub-buckets per power of two above,
+// so any percentile is off by less than 1/16 of its value. Fixed memory, no allocation on record.
+// One thread records, others may read percentiles concurrently.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+namespace LedMapper {
+
+using LatencyClock = std::chrono::steady_clock;
+
+/// kernel receive timestamps are CLOCK_REALTIME, move them to steady clock by their age
+inline LatencyClock::time_point fromRealtime(const timespec &stamp)
+{
+    const auto steadyNow = LatencyClock::now();
+    if (stamp.tv_sec == 0 && stamp.tv_nsec == 0)
+        return steadyNow;
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const auto age = std::chrono::seconds(now.tv_sec - stamp.tv_sec)
+                     + std::chrono::nanoseconds(now.tv_nsec - stamp.tv_nsec);
+    return steadyNow - std::chrono::duration_cast<LatencyClock::duration>(age);
+}
+
+class LatencyHistogram {
+public:
+    static constexpr size_t LINEAR = 32; // exact buckets for 0..31 us
+    static constexpr size_t SUB_BUCKETS = 16; // per power of two above
+    static constexpr size_t BUCKETS = LINEAR + 27 * SUB_BUCKETS; // up to 2^32 us
+
+    LatencyHistogram()
+    {
+        for (auto &bucket : m_buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+    }
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    /// single writer, so plain load and store instead of atomic increment
+    void record(LatencyClock::duration latency)
+    {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        const uint64_t value = us < 0 ? 0 : static_cast<uint64_t>(us);
+        auto &bucket = m_buckets[index(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    /// of all recorded values in us
+    uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+    /// upper bound in us of bucket holding quantile q of recorded values (0.5, 0.99, 0.999), 0 if empty
+    uint64_t percentile(double q) const
+    {
+        const uint64_t total = count();
+        if (total == 0)
+            return 0;
+        const uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return upperBound(i);
+        }
+        return upperBound(BUCKETS - 1);
+    }
+
+private:
+    static size_t index(uint64_t us)
+    {
+        if (us < LINEAR)
+            return us;
+        if (us >= (uint64_t(1) << 32))
+            return BUCKETS - 1;
+        const unsigned shift = (63 - __builtin_clzll(us)) - 4; // keep top 5 bits, first of them is 1
+        return LINEAR + (shift - 1) * SUB_BUCKETS + ((us >> shift) - SUB_BUCKETS);
+    }
+
+    static uint64_t upperBound(size_t i)
+    {
+        if (i < LINEAR)
+            return i;
+        const unsigned shift = (i - LINEAR) / SUB_BUCKETS + 1;
+        const uint64_t top = (i - LINEAR) % SUB_BUCKETS + SUB_BUCKETS;
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::array<std::atomic<uint32_t>, BUCKETS> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+};
+
+/// stages of frame from kernel receive to output and time spent in output, recorded by render thread
+enum class LatencyStage : size_t {
+    Receive, // kernel receive of last datagram of frame to its header parsed
+    Convert, // header parsed to frame converted and handed to render thread
+    Output, // handed to render thread to render or SPI write returned
+    Total, // kernel receive to render or SPI write returned
+    WsRender, // WS render call, DMA start
+    SpiSend, // SPI writes of all channels with latch wait
+    COUNT
+};
+
+class LatencyStats {
+public:
+    static constexpr size_t SIZE = static_cast<size_t>(LatencyStage::COUNT);
+
+    LatencyHistogram &operator[](LatencyStage stage) { return m_stages[static_cast<size_t>(stage)]; }
+    const LatencyHistogram &operator[](LatencyStage stage) const { return m_stages[static_cast<size_t>(stage)]; }
+
+    static const char *name(LatencyStage stage)
+    {
+        static const char *names[SIZE] = { "receive", "convert", "output", "total", "ws_render", "spi_send" };
+        return names[static_cast<size_t>(stage)];
+    }
+
+private:
+    std::array<LatencyHistogram, SIZE> m_stages;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,192 @@
+//
+// Minimal HTTP server for Prometheus scrapes, runs on EventLoop thread:
+// every request gets metrics text from writer and connection is closed after response
+//
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <netinet/in.h>
+#include <ostream>
+#include <sstream>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include "PipelineStats.h"
+#include "easylogging++.h"
+
+namespace LedMapper {
+
+class MetricsServer {
+public:
+    using Writer = std::function<void(std::ostream &)>;
+
+    static constexpr size_t MAX_CLIENTS = 4; // oldest client is dropped for new one
+    static constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+    MetricsServer(EventLoop &loop, Writer writer)
+        : m_loop(loop)
+        , m_writer(std::move(writer))
+        , m_listenFd(-1)
+    {
+    }
+
+    ~MetricsServer()
+    {
+        while (!m_clients.empty())
+            closeClient(m_clients.begin()->first);
+        if (m_listenFd >= 0) {
+            m_loop.remove(m_listenFd);
+            close(m_listenFd);
+        }
+    }
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    /// listen on all interfaces
+    bool listen(uint16_t port)
+    {
+        m_listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_listenFd < 0) {
+            LOG(ERROR) << "Metrics socket failed: " << errno << "-" << strerror(errno);
+            return false;
+        }
+        int on = 1;
+        setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+            || ::listen(m_listenFd, MAX_CLIENTS) != 0) {
+            LOG(ERROR) << "Metrics bind to port=" << port << " failed: " << errno << "-" << strerror(errno);
+            close(m_listenFd);
+            m_listenFd = -1;
+            return false;
+        }
+        return m_loop.add(m_listenFd, [this]() { onAccept(); });
+    }
+
+private:
+    struct Client {
+        std::chrono::steady_clock::time_point accepted;
+        std::string request;
+    };
+
+    void onAccept()
+    {
+        int fd;
+        while ((fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            if (m_clients.size() >= MAX_CLIENTS) {
+                auto oldest = m_clients.begin();
+                for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+                    if (it->second.accepted < oldest->second.accepted)
+                        oldest = it;
+                closeClient(oldest->first);
+            }
+            m_clients[fd].accepted = std::chrono::steady_clock::now();
+            m_loop.add(fd, [this, fd]() { onReadable(fd); });
+        }
+    }
+
+    void onReadable(int fd)
+    {
+        char buf[512];
+        ssize_t size = recv(fd, buf, sizeof(buf), 0);
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        auto &request = m_clients[fd].request;
+        if (size <= 0 || request.size() + size > MAX_REQUEST_SIZE) {
+            closeClient(fd);
+            return;
+        }
+        request.append(buf, size);
+        /// body of GET is not expected, headers end is end of request
+        if (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos)
+            return;
+        respond(fd, request);
+        closeClient(fd);
+    }
+
+    void respond(int fd, const std::string &request)
+    {
+        std::ostringstream body;
+        const char *status = "200 OK";
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+            m_writer(body);
+        else
+            status = "404 Not Found";
+        const std::string text = body.str();
+        std::ostringstream response;
+        response << "HTTP/1.0 " << status << "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                 << text.size() << "\r\nConnection: close\r\n\r\n"
+                 << text;
+        /// response fits into socket send buffer of fresh connection, client which doesn't take it is dropped
+        const std::string out = response.str();
+        if (send(fd, out.data(), out.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(out.size()))
+            LOG(DEBUG) << "Metrics response not sent completely";
+    }
+
+    void closeClient(int fd)
+    {
+        m_loop.remove(fd);
+        close(fd);
+        m_clients.erase(fd);
+    }
+
+    EventLoop &m_loop;
+    Writer m_writer;
+    int m_listenFd;
+    std::map<int, Client> m_clients;
+};
+
+/// pipeline counters in Prometheus text format, fps and drop rates are rate() of them
+inline void writeMetrics(std::ostream &out, const PipelineStats &stats)
+{
+    for (size_t i = 0; i < PipelineStats::SIZE; ++i) {
+        const auto counter = static_cast<Counter>(i);
+        out << "# TYPE ledmapper_" << PipelineStats::name(counter) << "_total counter\n"
+            << "ledmapper_" << PipelineStats::name(counter) << "_total " << stats.get(counter) << "\n";
+    }
+}
+
+/// latency stages as summary with p50/p99/p99.9 quantiles in seconds
+inline void writeMetrics(std::ostream &out, const LatencyStats &latency)
+{
+    out << "# TYPE ledmapper_latency_seconds summary\n";
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+    for (size_t i = 0; i < LatencyStats::SIZE; ++i) {
+        const auto stage = static_cast<LatencyStage>(i);
+        const char *name = LatencyStats::name(stage);
+        for (double q : quantiles)
+            out << "ledmapper_latency_seconds{stage=\"" << name << "\",quantile=\"" << q << "\"} "
+                << latency[stage].percentile(q) / 1e6 << "\n";
+        out << "ledmapper_latency_seconds_sum{stage=\"" << name << "\"} " << latency[stage].sum() / 1e6 << "\n"
+            << "ledmapper_latency_seconds_count{stage=\"" << name << "\"} " << latency[stage].count() << "\n";
+    }
+}
+
+/// user and system CPU time of all threads, standard name so dashboards for other exporters work
+inline void writeProcessMetrics(std::ostream &out)
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return;
+    const double cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+                       + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    out << "# TYPE process_cpu_seconds_total counter\n"
+        << "process_cpu_seconds_total " << cpu << "\n";
+}
+
+} // namespace LedMapper
@@ -0,0 +1,81 @@
+//
+// Counters of receive-convert-render pipeline, shared by event loop and render threads.
+// Counters are monotonic since start, relaxed atomics as they are read only for reporting.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LedMapper {
+
+enum class Counter : size_t {
+    DatagramsReceived, // all inputs
+    KernelDrops, // datagrams dropped by kernel on full receive queues
+    FramesParsed, // frames converted and handed to render thread
+    FramesRendered,
+    FramesRenderFailed, // output write failed, frame not shown completely
+    FramesSkipped, // replaced by newer frame before render
+    FramesMalformed,
+    FramesLate, // sequenced frames older than shown one
+    FramesLost, // gaps in sequence of shown frames
+    FragmentsRecovered, // rebuilt from parity
+    FragmentedFramesDropped, // incomplete on timeout or eviction
+    COUNT
+};
+
+class PipelineStats {
+public:
+    static constexpr size_t SIZE = static_cast<size_t>(Counter::COUNT);
+    using Snapshot = std::array<uint64_t, SIZE>;
+
+    PipelineStats()
+    {
+        for (auto &counter : m_counters)
+            counter.store(0, std::memory_order_relaxed);
+    }
+
+    PipelineStats(const PipelineStats &) = delete;
+    PipelineStats &operator=(const PipelineStats &) = delete;
+
+    void add(Counter counter, uint64_t count = 1)
+    {
+        m_counters[static_cast<size_t>(counter)].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /// for counters kept elsewhere (kernel, assembler), copied in before reporting
+    void set(Counter counter, uint64_t value)
+    {
+        m_counters[static_cast<size_t>(counter)].store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t get(Counter counter) const
+    {
+        return m_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot() const
+    {
+        Snapshot values;
+        for (size_t i = 0; i < SIZE; ++i)
+            values[i] = m_counters[i].load(std::memory_order_relaxed);
+        return values;
+    }
+
+    static const char *name(Counter counter)
+    {
+        static const char *names[SIZE] = { "datagrams_received",  "kernel_drops",                "frames_parsed",
+                                           "frames_rendered",     "frames_render_failed",        "frames_skipped",
+                                           "frames_malformed",    "frames_late",                 "frames_lost",
+                                           "fragments_recovered", "fragmented_frames_dropped" };
+        return names[static_cast<size_t>(counter)];
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, SIZE> m_counters;
+};
+
+} // namespace LedMapper
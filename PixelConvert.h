@@ -0,0 +1,95 @@
+//
+// Bulk converters from packed RGB24 frame pixels into output formats.
+// NEON or SSSE3 kernels are used when compiled for them, scalar versions are the reference.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LM_PIXEL_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define LM_PIXEL_SSSE3 1
+#endif
+
+namespace LedMapper {
+
+/// RGB24 -> ws2811_led_t (0x00RRGGBB) reference, bytes are read unsigned
+inline void rgb24ToWsScalar(const uint8_t *rgb, uint32_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, rgb += 3)
+        out[i] = (static_cast<uint32_t>(rgb[0]) << 16) | (static_cast<uint32_t>(rgb[1]) << 8) | rgb[2];
+}
+
+/// RGB24 -> ws2811_led_t (0x00RRGGBB), vectorized by 16 leds with scalar tail
+inline void rgb24ToWs(const uint8_t *rgb, uint32_t *out, size_t count)
+{
+    size_t i = 0;
+#if defined(LM_PIXEL_NEON)
+    /// deinterleave 16 pixels and store them interleaved as B,G,R,0 bytes == little endian 0x00RRGGBB
+    const uint8x16_t zero = vdupq_n_u8(0);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t px = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t led;
+        led.val[0] = px.val[2];
+        led.val[1] = px.val[1];
+        led.val[2] = px.val[0];
+        led.val[3] = zero;
+        vst4q_u8(reinterpret_cast<uint8_t *>(out + i), led);
+    }
+#elif defined(LM_PIXEL_SSSE3)
+    /// 4 pixels per 16 byte load, last 4 loaded bytes belong to next pixels,
+    /// so loop stops while a whole load still fits in rgb span
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    for (; i + 6 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_shuffle_epi8(px, shuffle));
+    }
+#endif
+    rgb24ToWsScalar(rgb + i * 3, out + i, count - i);
+}
+
+/// RGB24 -> SK9822 wire format, 4 bytes per led in 0xFF,B,G,R order, reference
+inline void rgb24ToSk9822Scalar(const uint8_t *rgb, uint8_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, rgb += 3, out += 4) {
+        out[0] = 0xFF;
+        out[1] = rgb[2];
+        out[2] = rgb[1];
+        out[3] = rgb[0];
+    }
+}
+
+/// RGB24 -> SK9822 wire format, 4 bytes per led in 0xFF,B,G,R order, vectorized with scalar tail
+inline void rgb24ToSk9822(const uint8_t *rgb, uint8_t *out, size_t count)
+{
+    size_t i = 0;
+#if defined(LM_PIXEL_NEON)
+    const uint8x16_t brightness = vdupq_n_u8(0xFF);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t px = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t led;
+        led.val[0] = brightness;
+        led.val[1] = px.val[2];
+        led.val[2] = px.val[1];
+        led.val[3] = px.val[0];
+        vst4q_u8(out + i * 4, led);
+    }
+#elif defined(LM_PIXEL_SSSE3)
+    /// same load bounds as in rgb24ToWs, brightness byte is zeroed by shuffle and set by OR
+    const __m128i shuffle = _mm_setr_epi8(-1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+    const __m128i brightness = _mm_set1_epi32(0xFF);
+    for (; i + 6 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4),
+                         _mm_or_si128(_mm_shuffle_epi8(px, shuffle), brightness));
+    }
+#endif
+    rgb24ToSk9822Scalar(rgb + i * 3, out + i * 4, count - i);
+}
+
+} // namespace LedMapper
@@ -0,0 +1,48 @@
+/*
+ * USDT (SystemTap SDT) probes on frame path for bpftrace and perf, provider "ledmapper".
+ * Each probe is a nop plus ELF note until a tracer attaches, so they stay in release builds:
+ *   bpftrace -l 'usdt:./lmListener:ledmapper:*'
+ * Probes are built in when <sys/sdt.h> (systemtap-sdt-dev) is found and compile to nothing otherwise.
+ * LM_PROBES requests them and warns when the header is missing, LM_NO_PROBES leaves them out.
+ * Included from C and C++.
+ */
+
+#pragma once
+
+#ifndef LM_NO_PROBES
+#ifdef __has_include
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define LM_PROBES_ENABLED 1
+#endif
+#endif
+#if defined(LM_PROBES) && !defined(LM_PROBES_ENABLED)
+#warning "LM_PROBES is set but <sys/sdt.h> is not found, USDT probes are disabled: install systemtap-sdt-dev"
+#endif
+#endif
+
+#ifdef LM_PROBES_ENABLED
+#define LM_PROBE0(name) DTRACE_PROBE(ledmapper, name)
+#define LM_PROBE1(name, a) DTRACE_PROBE1(ledmapper, name, a)
+#define LM_PROBE2(name, a, b) DTRACE_PROBE2(ledmapper, name, a, b)
+#define LM_PROBE3(name, a, b, c) DTRACE_PROBE3(ledmapper, name, a, b, c)
+#else
+#define LM_PROBE0(name) \
+    do {                \
+    } while (0)
+#define LM_PROBE1(name, a) \
+    do {                   \
+        (void)(a);         \
+    } while (0)
+#define LM_PROBE2(name, a, b) \
+    do {                      \
+        (void)(a);            \
+        (void)(b);            \
+    } while (0)
+#define LM_PROBE3(name, a, b, c) \
+    do {                         \
+        (void)(a);               \
+        (void)(b);               \
+        (void)(c);               \
+    } while (0)
+#endif
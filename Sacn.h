@@ -0,0 +1,143 @@
+//
+// sACN (ANSI E1.31) packets and source priority arbitration, universes are gathered into frames by UniverseFrame.
+// Each universe is sent to its own multicast group, so receiver joins only groups of universes it maps.
+//
+// Data packet, all fields big-endian:
+//   root layer:    u16 preamble 0x0010, u16 postamble, "ASC-E1.17\0\0\0", u16 flags/length,
+//                  u32 vector 0x04 (data) or 0x08 (extended: sync), 16 byte CID of source
+//   framing layer: u16 flags/length, u32 vector 0x02, 64 byte source name, u8 priority, u16 sync universe,
+//                  u8 sequence, u8 options, u16 universe
+//   DMP layer:     u16 flags/length, u8 vector 0x02, u8 0xA1, u16 0, u16 1, u16 count, start code, DMX slots
+// Sync packet: root layer with vector 0x08, framing layer u16 flags/length, u32 vector 0x01, u8 sequence,
+//   u16 sync universe, u16 reserved.
+//
+
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "UniverseFrame.h"
+
+namespace LedMapper {
+
+constexpr unsigned short SACN_PORT = 5568;
+constexpr uint32_t SACN_VECTOR_ROOT_DATA = 0x04;
+constexpr uint32_t SACN_VECTOR_ROOT_EXTENDED = 0x08;
+constexpr uint32_t SACN_VECTOR_FRAMING_DATA = 0x02;
+constexpr uint32_t SACN_VECTOR_EXTENDED_SYNC = 0x01;
+constexpr size_t SACN_DATA_OFFSET = 126; // first DMX slot after start code
+constexpr size_t SACN_SYNC_SIZE = 49;
+constexpr size_t SACN_CID_SIZE = 16;
+constexpr uint8_t SACN_OPTION_PREVIEW = 0x80;
+constexpr uint8_t SACN_OPTION_TERMINATED = 0x40;
+
+struct SacnDmx {
+    const uint8_t *cid;
+    uint8_t priority;
+    uint16_t syncUniverse;
+    uint8_t options;
+    uint16_t universe;
+    const uint8_t *data;
+    size_t length;
+};
+
+namespace detail {
+inline uint16_t be16(const uint8_t *bytes) { return bytes[0] << 8 | bytes[1]; }
+inline uint32_t be32(const uint8_t *bytes) { return uint32_t(be16(bytes)) << 16 | be16(bytes + 2); }
+} // namespace detail
+
+/// root layer vector of sACN packet or 0 if datagram is not sACN
+inline uint32_t sacnRootVector(const char *message, size_t size)
+{
+    static const char id[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+    if (size < 38 || memcmp(message + 4, id, sizeof(id)) != 0)
+        return 0;
+    return detail::be32(reinterpret_cast<const uint8_t *>(message) + 18);
+}
+
+/// point dmx to data packet fields, returns false if packet is malformed or its start code is not DMX
+inline bool readSacnDmx(const char *message, size_t size, SacnDmx &dmx)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message);
+    if (size < SACN_DATA_OFFSET || sacnRootVector(message, size) != SACN_VECTOR_ROOT_DATA
+        || detail::be32(bytes + 40) != SACN_VECTOR_FRAMING_DATA || bytes[117] != 0x02 || bytes[125] != 0)
+        return false;
+    const size_t count = detail::be16(bytes + 123);
+    dmx.cid = bytes + 22;
+    dmx.priority = bytes[108];
+    dmx.syncUniverse = detail::be16(bytes + 109);
+    dmx.options = bytes[112];
+    dmx.universe = detail::be16(bytes + 113);
+    dmx.data = bytes + SACN_DATA_OFFSET;
+    dmx.length = count > 0 ? count - 1 : 0;
+    return count > 0 && dmx.length <= DMX_SLOTS && dmx.length <= size - SACN_DATA_OFFSET;
+}
+
+/// sync universe of sync packet or 0 if datagram is not sync packet
+inline uint16_t readSacnSync(const char *message, size_t size)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message);
+    if (size < SACN_SYNC_SIZE || sacnRootVector(message, size) != SACN_VECTOR_ROOT_EXTENDED
+        || detail::be32(bytes + 40) != SACN_VECTOR_EXTENDED_SYNC)
+        return 0;
+    return detail::be16(bytes + 45);
+}
+
+/// multicast group of universe, 239.255.hi.lo
+inline void sacnMulticastAddress(uint16_t universe, char (&address)[16])
+{
+    snprintf(address, sizeof(address), "239.255.%u.%u", universe >> 8, universe & 0xFF);
+}
+
+///
+/// Per universe source arbitration: highest priority source wins, its data is taken until it terminates
+/// stream or is silent for longer than timeout, sources with equal priority don't take over active one
+///
+class SacnSources {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SacnSources(Clock::duration timeout)
+        : m_timeout(timeout)
+    {
+        for (auto &source : m_sources)
+            source.active = false;
+    }
+
+    /// true if packet of universe index (relative to first mapped universe) has to be taken
+    bool accept(size_t index, const SacnDmx &dmx, Clock::time_point now)
+    {
+        Source &source = m_sources[index];
+        const bool current = source.active && memcmp(source.cid, dmx.cid, SACN_CID_SIZE) == 0;
+        if (dmx.options & SACN_OPTION_TERMINATED) {
+            if (current)
+                source.active = false;
+            return false;
+        }
+        if (current || !source.active || now - source.lastSeen > m_timeout || dmx.priority > source.priority) {
+            source.active = true;
+            source.priority = dmx.priority;
+            memcpy(source.cid, dmx.cid, SACN_CID_SIZE);
+            source.lastSeen = now;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Source {
+        bool active;
+        uint8_t priority;
+        uint8_t cid[SACN_CID_SIZE];
+        Clock::time_point lastSeen;
+    };
+
+    Clock::duration m_timeout;
+    Source m_sources[DMX_MAX_UNIVERSES];
+};
+
+} // namespace LedMapper
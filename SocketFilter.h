@@ -0,0 +1,173 @@
+//
+// Classic BPF programs for UdpSettings::filter, they check protocol magic, version and target bytes
+// in kernel, so foreign traffic on shared network is dropped before it wakes event loop.
+// Filter of UDP socket sees datagram with UDP header, payload offsets are shifted past it.
+//
+
+#pragma once
+
+#include <linux/filter.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Ddp.h"
+#include "FrameProtocol.h"
+#include "Sacn.h"
+
+namespace LedMapper {
+
+///
+/// Builder of straight line filter: loads and checks run in order, failed check rejects datagram,
+/// datagram passing all checks or hitting acceptIf() is accepted
+///
+class SocketFilter {
+public:
+    static constexpr uint32_t UDP_HEADER = 8;
+
+    /// A = payload byte, big-endian half word or word at offset
+    SocketFilter &loadByte(uint32_t offset) { return load(BPF_B, offset); }
+    SocketFilter &loadHalf(uint32_t offset) { return load(BPF_H, offset); }
+    SocketFilter &loadWord(uint32_t offset) { return load(BPF_W, offset); }
+
+    /// A = payload size
+    SocketFilter &loadSize()
+    {
+        add(BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0));
+        add(BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, UDP_HEADER));
+        return *this;
+    }
+
+    /// A = universe of Art-Net ArtDmx, 15 bit little-endian with top byte masked
+    SocketFilter &loadArtNetUniverse()
+    {
+        loadByte(15);
+        add(BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x7F));
+        add(BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 8));
+        add(BPF_STMT(BPF_MISC | BPF_TAX, 0));
+        loadByte(14);
+        add(BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0));
+        return *this;
+    }
+
+    SocketFilter &mask(uint32_t bits)
+    {
+        add(BPF_STMT(BPF_ALU | BPF_AND | BPF_K, bits));
+        return *this;
+    }
+
+    SocketFilter &rejectUnless(uint32_t value) { return jump(BPF_JEQ, value, NEXT, REJECT); }
+    SocketFilter &acceptIf(uint32_t value) { return jump(BPF_JEQ, value, ACCEPT, NEXT); }
+    SocketFilter &acceptUnless(uint32_t value) { return jump(BPF_JEQ, value, NEXT, ACCEPT); }
+    SocketFilter &rejectIfLess(uint32_t value) { return jump(BPF_JGE, value, NEXT, REJECT); }
+    SocketFilter &rejectIfGreater(uint32_t value) { return jump(BPF_JGT, value, REJECT, NEXT); }
+
+    /// resolve jumps and append accept and reject returns
+    std::vector<sock_filter> program() const
+    {
+        std::vector<sock_filter> code = m_code;
+        const size_t accept = code.size(), reject = code.size() + 1;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (BPF_CLASS(code[i].code) != BPF_JMP)
+                continue;
+            code[i].jt = target(m_targets[i].first, i, accept, reject);
+            code[i].jf = target(m_targets[i].second, i, accept, reject);
+        }
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF));
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, 0));
+        return code;
+    }
+
+private:
+    enum Target { NEXT, ACCEPT, REJECT };
+
+    SocketFilter &load(uint16_t size, uint32_t offset)
+    {
+        add(BPF_STMT(BPF_LD | size | BPF_ABS, UDP_HEADER + offset));
+        return *this;
+    }
+
+    SocketFilter &jump(uint16_t op, uint32_t value, Target onTrue, Target onFalse)
+    {
+        add(BPF_JUMP(BPF_JMP | op | BPF_K, value, 0, 0), onTrue, onFalse);
+        return *this;
+    }
+
+    void add(sock_filter insn, Target onTrue = NEXT, Target onFalse = NEXT)
+    {
+        m_code.push_back(insn);
+        m_targets.emplace_back(onTrue, onFalse);
+    }
+
+    /// jump offsets are relative to next instruction, programs here are far shorter than 255 of them
+    static uint8_t target(Target to, size_t from, size_t accept, size_t reject)
+    {
+        return to == NEXT ? 0 : (to == ACCEPT ? accept : reject) - from - 1;
+    }
+
+    std::vector<sock_filter> m_code;
+    std::vector<std::pair<Target, Target>> m_targets;
+};
+
+/// native frames: legacy ones longer than 4 bytes, "LM" ones of known versions
+inline std::vector<sock_filter> frameSocketFilter()
+{
+    return SocketFilter()
+        .loadSize()
+        .rejectIfLess(5)
+        .loadHalf(0)
+        .acceptUnless(FRAME_MAGIC_0 << 8 | FRAME_MAGIC_1)
+        .loadByte(2)
+        .rejectIfLess(FRAME_VERSION_FRAGMENTED)
+        .rejectIfGreater(FRAME_VERSION_FIXED)
+        .program();
+}
+
+/// ArtSync and ArtDmx of universes [first, first + count)
+inline std::vector<sock_filter> artNetSocketFilter(uint16_t first, size_t count)
+{
+    return SocketFilter()
+        .loadWord(0)
+        .rejectUnless(0x4172742D) // "Art-"
+        .loadWord(4)
+        .rejectUnless(0x4E657400) // "Net\0"
+        .loadHalf(8)
+        .acceptIf(0x0052) // ArtSync opcode read big-endian
+        .rejectUnless(0x0050) // ArtDmx
+        .loadArtNetUniverse()
+        .rejectIfLess(first)
+        .rejectIfGreater(first + count - 1)
+        .program();
+}
+
+/// E1.31 sync packets and data packets of universes [first, first + count)
+inline std::vector<sock_filter> sacnSocketFilter(uint16_t first, size_t count)
+{
+    return SocketFilter()
+        .loadWord(4)
+        .rejectUnless(0x4153432D) // "ASC-"
+        .loadWord(8)
+        .rejectUnless(0x45312E31) // "E1.1"
+        .loadWord(18)
+        .acceptIf(SACN_VECTOR_ROOT_EXTENDED)
+        .rejectUnless(SACN_VECTOR_ROOT_DATA)
+        .loadHalf(113)
+        .rejectIfLess(first)
+        .rejectIfGreater(first + count - 1)
+        .program();
+}
+
+/// DDP v1 packets addressed to display or to all devices
+inline std::vector<sock_filter> ddpSocketFilter()
+{
+    return SocketFilter()
+        .loadByte(0)
+        .mask(DDP_VERSION_MASK)
+        .rejectUnless(DDP_VERSION_1)
+        .loadByte(3)
+        .acceptIf(DDP_ID_DISPLAY)
+        .rejectUnless(DDP_ID_ALL)
+        .program();
+}
+
+} // namespace LedMapper
@@ -0,0 +1,77 @@
+//
+// Lock-free single producer / single consumer ring of preallocated slots.
+// Producer fills slot in place and publishes it, consumer reads it in place and releases it,
+// so no copies and no allocations happen after construction.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+
+namespace LedMapper {
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be power of two");
+
+public:
+    SpscRing()
+        : m_head(0)
+        , m_tail(0)
+    {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /// producer: free slot to fill or nullptr if ring is full
+    T *producerSlot()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+            return nullptr;
+        return &m_slots[head & (Capacity - 1)];
+    }
+
+    /// producer: make slot returned by producerSlot() visible to consumer
+    void publish() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /// consumer: oldest published slot or nullptr if ring is empty
+    T *consumerSlot()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_slots[tail & (Capacity - 1)];
+    }
+
+    /// consumer: newest published slot, all older ones are released unread
+    T *latestSlot()
+    {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == head)
+            return nullptr;
+        m_tail.store(head - 1, std::memory_order_release);
+        return &m_slots[(head - 1) & (Capacity - 1)];
+    }
+
+    /// consumer: return slot got from consumerSlot() or latestSlot() to producer
+    void release() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    size_t size() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    /// indexes grow monotonically and are masked on access, kept on separate cache lines
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) std::array<T, Capacity> m_slots;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,73 @@
+//
+// Wait-free triple buffer: producer always owns a free back slot to write into,
+// consumer always takes the most recent complete slot, slots are swapped by index, never copied.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LedMapper {
+
+/// ProducerSlots > 1 gives producer several back slots to fill in parallel (e.g. one per frame in reassembly),
+/// any of them can be published, consumer side stays the same
+template <typename T, size_t ProducerSlots = 1>
+class TripleBuffer {
+    static_assert(ProducerSlots >= 1 && ProducerSlots + 2 <= 16, "TripleBuffer supports 1..14 producer slots");
+
+public:
+    TripleBuffer()
+        : m_middle(ProducerSlots)
+        , m_front(ProducerSlots + 1)
+    {
+        for (size_t i = 0; i < ProducerSlots; ++i)
+            m_back[i] = i;
+    }
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /// producer: slot to fill with next frame
+    T &back(size_t i = 0) { return m_slots[m_back[i]]; }
+
+    /// producer: hand back slot to consumer, previous unconsumed frame is dropped
+    /// and its slot becomes back slot i, returns false if previous frame was not taken by consumer yet
+    bool publish(size_t i = 0)
+    {
+        const uint8_t prev = m_middle.exchange(m_back[i] | FRESH, std::memory_order_acq_rel);
+        m_back[i] = prev & INDEX;
+        return (prev & FRESH) == 0;
+    }
+
+    /// consumer: take most recent published frame into front(),
+    /// returns false if nothing new was published since last call
+    bool acquire()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /// consumer: latest acquired frame
+    T &front() { return m_slots[m_front]; }
+
+    /// direct slot access for initialization before producer and consumer start
+    T &slot(size_t i) { return m_slots[i]; }
+    static constexpr size_t size() { return ProducerSlots + 2; }
+
+private:
+    static constexpr uint8_t INDEX = 0x0F;
+    static constexpr uint8_t FRESH = 0x10;
+
+    /// m_back is touched only by producer, m_front only by consumer
+    alignas(64) uint8_t m_back[ProducerSlots];
+    alignas(64) std::atomic<uint8_t> m_middle;
+    alignas(64) uint8_t m_front;
+    std::array<T, ProducerSlots + 2> m_slots;
+};
+
+} // namespace LedMapper
@@ -3,9 +3,11 @@
 //
 
 #include "UdpManager.h"
+#include "Probes.h"
 #include "ofxNetworkUtils.h"
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <stdio.h>
 
 namespace LedMapper {
 
@@ -29,6 +31,7 @@ UdpManager::UdpManager()
     m_hSocket = INVALID_SOCKET;
     m_dwTimeoutReceive = OF_UDP_DEFAULT_TIMEOUT;
     m_dwTimeoutSend = OF_UDP_DEFAULT_TIMEOUT;
+    m_kernelDrops = 0;
 
     canGetRemoteAddress = false;
     nonBlocking = true;
@@ -82,6 +85,13 @@ bool UdpManager::Setup(const UdpSettings &settings)
     if (settings.sendBufferSize)
         SetSendBufferSize(settings.sendBufferSize);
     SetTTL(settings.ttl);
+    if (settings.dropCounter)
+        SetDropCounter(true);
+    if (settings.timestamps)
+        SetTimestamps(true);
+    /// filter only saves wakeups, receiving works without it
+    if (!settings.filter.empty() && !SetFilter(settings.filter))
+        LOG(WARNING) << "Failed to attach socket filter, all datagrams go to userspace";
 
     if (settings.bindPort) {
         if (settings.multicast) {
@@ -218,6 +228,16 @@ bool UdpManager::BindMcast(char *pMcast, unsigned short usPort)
     }
 
     // join the multicast group
+    if (!JoinMcast(pMcast))
+        return false;
+
+    // multicast bind successful
+    return true;
+}
+
+//--------------------------------------------------------------------------------
+bool UdpManager::JoinMcast(const char *pMcast)
+{
     struct ip_mreq mreq;
     mreq.imr_multiaddr.s_addr = inet_addr(pMcast);
     mreq.imr_interface.s_addr = INADDR_ANY;
@@ -227,11 +247,22 @@ bool UdpManager::BindMcast(char *pMcast, unsigned short usPort)
         ofxNetworkCheckError();
         return false;
     }
-
-    // multicast bind successful
     return true;
 }
 
+//--------------------------------------------------------------------------------
+int UdpManager::GetMaxMcastMemberships()
+{
+    int memberships = -1;
+    FILE *file = fopen("/proc/sys/net/ipv4/igmp_max_memberships", "r");
+    if (!file)
+        return -1;
+    if (fscanf(file, "%d", &memberships) != 1)
+        memberships = -1;
+    fclose(file);
+    return memberships;
+}
+
 //--------------------------------------------------------------------------------
 bool UdpManager::Connect(const char *pHost, unsigned short usPort)
 {
@@ -426,6 +457,7 @@ int UdpManager::Receive(char *pBuff, const int iSize)
 
     memset(pBuff, 0, iSize);
     ret = recvfrom(m_hSocket, pBuff, iSize, 0, (sockaddr *)&saClient, &nLen);
+    LM_PROBE2(receive, m_hSocket, ret);
 
     if (ret > 0) {
         // ofLogNotice("UdpManager") << "received from: " << inet_ntoa((in_addr)saClient.sin_addr);
@@ -445,6 +477,124 @@ int UdpManager::Receive(char *pBuff, const int iSize)
     //	return(recvfrom(m_hSocket, pBuff, iSize, 0));
 }
 
+//--------------------------------------------------------------------------------
+///	Receives without PeekReceive() and without clearing pBuff, MSG_TRUNC makes recvfrom
+///	return real datagram size so oversized datagrams are detected in the same syscall.
+///	Return values:
+///	size of datagram, greater than iSize if it was truncated
+///	SOCKET_TIMEOUT indicates timeout
+///	SOCKET_ERROR in	case of	a problem.
+int UdpManager::ReceiveDirect(char *pBuff, const int iSize)
+{
+    if (m_hSocket == INVALID_SOCKET) {
+        LOG(ERROR) << "INVALID_SOCKET";
+        return (SOCKET_ERROR);
+    }
+
+    if (m_dwTimeoutReceive != NO_TIMEOUT) {
+        auto ret = WaitReceive(m_dwTimeoutReceive, 0);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    socklen_t nLen = sizeof(sockaddr);
+    int ret = recvfrom(m_hSocket, pBuff, iSize, MSG_TRUNC, (sockaddr *)&saClient, &nLen);
+    LM_PROBE2(receive, m_hSocket, ret);
+
+    if (ret > 0) {
+        canGetRemoteAddress = true;
+    }
+    else {
+        canGetRemoteAddress = false;
+
+        int SocketError = ofxNetworkCheckError();
+        if (SocketError == OFXNETWORK_ERROR(WOULDBLOCK))
+            return 0;
+    }
+
+    return ret;
+}
+
+//--------------------------------------------------------------------------------
+void UdpManager::ReadControl(struct msghdr &msg, struct timespec *pStamp)
+{
+    if (pStamp)
+        *pStamp = timespec{ 0, 0 };
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+        if (cmsg->cmsg_type == SO_RXQ_OVFL)
+            memcpy(&m_kernelDrops, CMSG_DATA(cmsg), sizeof(m_kernelDrops));
+        else if (cmsg->cmsg_type == SCM_TIMESTAMPNS && pStamp)
+            memcpy(pStamp, CMSG_DATA(cmsg), sizeof(*pStamp));
+    }
+}
+
+//--------------------------------------------------------------------------------
+///	Drains up to iCount queued datagrams in one syscall.
+///	MSG_WAITFORONE makes blocking sockets wait only for the first datagram,
+///	MSG_TRUNC reports real size of datagrams which didn't fit into iSize.
+///	Return values:
+///	number of datagrams received, 0 if none is waiting
+///	SOCKET_TIMEOUT indicates timeout
+///	SOCKET_ERROR in	case of	a problem.
+int UdpManager::ReceiveBatch(char *pBuffs, const int iSize, int *pSizes, const int iCount, struct timespec *pStamps)
+{
+    if (m_hSocket == INVALID_SOCKET) {
+        LOG(ERROR) << "INVALID_SOCKET";
+        return (SOCKET_ERROR);
+    }
+
+    if (m_dwTimeoutReceive != NO_TIMEOUT) {
+        auto ret = WaitReceive(m_dwTimeoutReceive, 0);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    if (m_batchMsgs.size() < static_cast<size_t>(iCount)) {
+        m_batchMsgs.resize(iCount);
+        m_batchIovs.resize(iCount);
+        m_batchAddrs.resize(iCount);
+        m_batchControl.resize(iCount * BATCH_CONTROL_SIZE);
+    }
+
+    for (int i = 0; i < iCount; ++i) {
+        m_batchIovs[i].iov_base = pBuffs + i * iSize;
+        m_batchIovs[i].iov_len = iSize;
+        memset(&m_batchMsgs[i], 0, sizeof(struct mmsghdr));
+        m_batchMsgs[i].msg_hdr.msg_iov = &m_batchIovs[i];
+        m_batchMsgs[i].msg_hdr.msg_iovlen = 1;
+        m_batchMsgs[i].msg_hdr.msg_name = &m_batchAddrs[i];
+        m_batchMsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        m_batchMsgs[i].msg_hdr.msg_control = m_batchControl.data() + i * BATCH_CONTROL_SIZE;
+        m_batchMsgs[i].msg_hdr.msg_controllen = BATCH_CONTROL_SIZE;
+    }
+
+    int ret = recvmmsg(m_hSocket, m_batchMsgs.data(), iCount, MSG_WAITFORONE | MSG_TRUNC, NULL);
+    /// datagrams count, or -1
+    LM_PROBE2(receive_batch, m_hSocket, ret);
+
+    if (ret > 0) {
+        for (int i = 0; i < ret; ++i) {
+            pSizes[i] = m_batchMsgs[i].msg_len;
+            ReadControl(m_batchMsgs[i].msg_hdr, pStamps ? pStamps + i : nullptr);
+        }
+        saClient = m_batchAddrs[ret - 1];
+        canGetRemoteAddress = true;
+    }
+    else {
+        canGetRemoteAddress = false;
+
+        int SocketError = ofxNetworkCheckError();
+        if (SocketError == OFXNETWORK_ERROR(WOULDBLOCK))
+            return 0;
+    }
+
+    return ret;
+}
+
 void UdpManager::SetTimeoutSend(int timeoutInSeconds) { m_dwTimeoutSend = timeoutInSeconds; }
 
 void UdpManager::SetTimeoutReceive(int timeoutInSeconds) { m_dwTimeoutReceive = timeoutInSeconds; }
@@ -619,6 +769,50 @@ bool UdpManager::SetEnableBroadcast(bool enableBroadcast)
     }
 }
 
+//--------------------------------------------------------------------------------
+bool UdpManager::SetDropCounter(bool enable)
+{
+    int on = enable ? 1 : 0;
+
+    if (setsockopt(m_hSocket, SOL_SOCKET, SO_RXQ_OVFL, (char *)&on, sizeof(on)) == 0) {
+        return true;
+    }
+    else {
+        ofxNetworkCheckError();
+        return false;
+    }
+}
+
+//--------------------------------------------------------------------------------
+bool UdpManager::SetTimestamps(bool enable)
+{
+    int on = enable ? 1 : 0;
+
+    if (setsockopt(m_hSocket, SOL_SOCKET, SO_TIMESTAMPNS, (char *)&on, sizeof(on)) == 0) {
+        return true;
+    }
+    else {
+        ofxNetworkCheckError();
+        return false;
+    }
+}
+
+//--------------------------------------------------------------------------------
+bool UdpManager::SetFilter(const std::vector<sock_filter> &program)
+{
+    sock_fprog prog;
+    prog.len = program.size();
+    prog.filter = const_cast<sock_filter *>(program.data());
+
+    if (setsockopt(m_hSocket, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == 0) {
+        return true;
+    }
+    else {
+        ofxNetworkCheckError();
+        return false;
+    }
+}
+
 //--------------------------------------------------------------------------------
 int UdpManager::GetTTL()
 {
@@ -72,6 +72,7 @@ x) Close()
 #include <stdint.h>
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include <wchar.h>
 
 #ifndef WIN32
@@ -88,7 +89,9 @@ x) Close()
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <linux/filter.h>
 
 //#ifdef TARGET_LINUX
 // linux needs this:
@@ -150,6 +153,14 @@ public:
 
     bool broadcast = false;
     bool multicast = false;
+    /// count datagrams dropped by kernel on full receive queue, see UdpManager::GetKernelDrops()
+    bool dropCounter = false;
+    /// kernel receive time of each datagram, see UdpManager::ReceiveBatch()
+    bool timestamps = false;
+
+    /// classic BPF program run by kernel on each datagram before it is queued to socket,
+    /// datagrams it rejects never wake receiver (see SocketFilter.h), empty for no filter
+    std::vector<sock_filter> filter;
 };
 
 //--------------------------------------------------------------------------------
@@ -168,6 +179,8 @@ public:
     }
 
     bool HasSocket() const { return (m_hSocket) && (m_hSocket != INVALID_SOCKET); }
+    /// raw descriptor for registering in EventLoop
+    int GetSocket() const { return m_hSocket; }
     bool Close();
     bool Setup(const UdpSettings &settings);
     bool Create();
@@ -175,11 +188,26 @@ public:
     bool ConnectMcast(char *pMcast, unsigned short usPort);
     bool Bind(unsigned short usPort);
     bool BindMcast(char *pMcast, unsigned short usPort);
+    /// join one more multicast group on socket bound by BindMcast() or Bind()
+    bool JoinMcast(const char *pMcast);
+    /// multicast groups one socket may join (net.ipv4.igmp_max_memberships), -1 if unknown
+    static int GetMaxMcastMemberships();
     int Send(const char *pBuff, const int iSize);
     // all data will be sent guaranteed.
     int SendAll(const char *pBuff, const int iSize);
     int PeekReceive(); //	return number of bytes waiting
     int Receive(char *pBuff, const int iSize);
+    /// receive one datagram with a single recvfrom call, buffer is not cleared beforehand.
+    /// returns full datagram size, which is greater than iSize if datagram was truncated,
+    /// 0 if nothing is waiting or SOCKET_ERROR
+    int ReceiveDirect(char *pBuff, const int iSize);
+    /// receive all queued datagrams with a single recvmmsg call,
+    /// pBuffs holds iCount slots of iSize bytes each, full datagram sizes are written to pSizes
+    /// (greater than iSize for truncated datagrams).
+    /// when pStamps is given and SetTimestamps() is on, kernel receive time (CLOCK_REALTIME) of each
+    /// datagram is written there, zero if kernel attached none.
+    /// returns number of received datagrams, 0 if nothing is waiting or SOCKET_ERROR
+    int ReceiveBatch(char *pBuffs, const int iSize, int *pSizes, const int iCount, struct timespec *pStamps = nullptr);
     void SetTimeoutSend(int timeoutInSeconds);
     void SetTimeoutReceive(int timeoutInSeconds);
     int GetTimeoutSend();
@@ -193,6 +221,15 @@ public:
     int GetSendBufferSize();
     bool SetReuseAddress(bool allowReuse);
     bool SetEnableBroadcast(bool enableBroadcast);
+    /// enable SO_RXQ_OVFL: kernel attaches its drop counter to received datagrams
+    bool SetDropCounter(bool enable);
+    /// datagrams dropped by kernel because receive queue was full, as of last datagram got by ReceiveBatch(),
+    /// so drops are seen only after next datagram arrives
+    uint32_t GetKernelDrops() const { return m_kernelDrops; }
+    /// enable SO_TIMESTAMPNS: kernel attaches receive time to received datagrams
+    bool SetTimestamps(bool enable);
+    /// attach classic BPF socket filter, datagrams it returns 0 for are dropped in kernel
+    bool SetFilter(const std::vector<sock_filter> &program);
     bool SetNonBlocking(bool useNonBlocking);
     int GetMaxMsgSize();
     /// returns -1 on failure
@@ -207,6 +244,9 @@ protected:
 #endif
 
     int WaitReceive(time_t timeoutSeconds, time_t timeoutMillis);
+    /// pick counters and receive time kernel attached to received message
+    void ReadControl(struct msghdr &msg, struct timespec *pStamp);
+    static constexpr size_t BATCH_CONTROL_SIZE = 64;
     int WaitSend(time_t timeoutSeconds, time_t timeoutMillis);
 
     unsigned long m_dwTimeoutReceive;
@@ -219,6 +259,13 @@ protected:
 
     static bool m_bWinsockInit;
     bool canGetRemoteAddress;
+
+    /// recvmmsg headers reused between ReceiveBatch calls
+    std::vector<struct mmsghdr> m_batchMsgs;
+    std::vector<struct iovec> m_batchIovs;
+    std::vector<struct sockaddr_in> m_batchAddrs;
+    std::vector<char> m_batchControl; // ancillary data per message
+    uint32_t m_kernelDrops;
 };
 
 } // namespace LedMapper
\ No newline at end of file
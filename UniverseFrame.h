@@ -0,0 +1,103 @@
+//
+// DMX universes to output channels mapping and frame latching shared by Art-Net and sACN inputs.
+// Universes of frame are written straight into output buffers, frame is published on sync packet
+// while sender sends them, otherwise when all universes of previous frame arrived again.
+// Used from event loop thread only.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace LedMapper {
+
+constexpr size_t DMX_SLOTS = 512;
+constexpr size_t DMX_MAX_UNIVERSES = 64; // mapped universes, one bit each in frame masks
+
+/// universes firstUniverse.. are laid out channel by channel, universesPerChannel each,
+/// every universe holds pixelsPerUniverse RGB pixels starting from its first DMX slot
+struct UniverseMapping {
+    uint16_t firstUniverse = 0;
+    uint16_t universesPerChannel = 1;
+    uint16_t pixelsPerUniverse = 170;
+    size_t channels = 1;
+
+    /// number of mapped universes, they go from firstUniverse on
+    size_t universes() const { return std::min(DMX_MAX_UNIVERSES, channels * universesPerChannel); }
+};
+
+class UniverseFrame {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// sync mode lasts syncTimeout after last sync packet
+    UniverseFrame(const UniverseMapping &mapping, Clock::duration syncTimeout)
+        : m_mapping(mapping)
+        , m_syncTimeout(syncTimeout)
+        , m_lastSync()
+        , m_synced(false)
+        , m_received(0)
+        , m_expected(0)
+    {
+    }
+
+    /// channel and first led of universe, false if universe is not mapped
+    bool map(uint16_t universe, size_t &channel, size_t &firstLed) const
+    {
+        if (universe < m_mapping.firstUniverse)
+            return false;
+        const size_t index = universe - m_mapping.firstUniverse;
+        if (index >= DMX_MAX_UNIVERSES || index / m_mapping.universesPerChannel >= m_mapping.channels)
+            return false;
+        channel = index / m_mapping.universesPerChannel;
+        firstLed = index % m_mapping.universesPerChannel * m_mapping.pixelsPerUniverse;
+        return true;
+    }
+
+    /// true if universe was already received in current frame, so without sync packets
+    /// current frame has to be published before universe is written
+    bool repeats(uint16_t universe, Clock::time_point now) const
+    {
+        return !syncMode(now) && (m_received & bit(universe));
+    }
+
+    /// account mapped universe in current frame, returns true if frame is complete
+    /// and has to be published now, which never happens in sync mode
+    bool add(uint16_t universe, Clock::time_point now)
+    {
+        m_received |= bit(universe);
+        return !syncMode(now) && m_received == m_expected;
+    }
+
+    /// account sync packet, returns true if there is frame to publish
+    bool sync(Clock::time_point now)
+    {
+        m_lastSync = now;
+        m_synced = true;
+        return m_received != 0;
+    }
+
+    /// current frame was published, universes it had are expected in next ones
+    void published()
+    {
+        m_expected = m_received;
+        m_received = 0;
+    }
+
+    bool syncMode(Clock::time_point now) const { return m_synced && now - m_lastSync < m_syncTimeout; }
+
+private:
+    uint64_t bit(uint16_t universe) const { return uint64_t(1) << (universe - m_mapping.firstUniverse); }
+
+    UniverseMapping m_mapping;
+    Clock::duration m_syncTimeout;
+    Clock::time_point m_lastSync;
+    bool m_synced;
+    uint64_t m_received; // bit per mapped universe
+    uint64_t m_expected;
+};
+
+} // namespace LedMapper
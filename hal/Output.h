@@ -0,0 +1,70 @@
+//
+// Output backends used by lmListener: WS281x one wire strips, SPI strips and GPIO switches.
+// Real backends are in RealOutput.h, simulated ones for running without Pi are in SimOutput.h,
+// LM_SIM_OUTPUT build flag selects which of them lmListener is built with.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "../spi/sk9822led.h"
+
+#ifdef LM_SIM_OUTPUT
+typedef uint32_t ws2811_led_t; // 0xWWRRGGBB as in rpi_ws281x
+#else
+#include "../rpi_ws281x/ws2811.h"
+#endif
+
+namespace LedMapper {
+
+constexpr size_t WS_OUTPUT_CHANNELS = 2;
+
+class WsOutput {
+public:
+    virtual ~WsOutput() {}
+
+    /// init all channels with ledsCount leds each, output time scales with it
+    virtual bool init(size_t ledsCount) = 0;
+    virtual void fini() = 0;
+    virtual size_t ledsCount() const = 0;
+
+    /// start output of WS_OUTPUT_CHANNELS arrays with at least ledsCount() leds each,
+    /// returns as soon as transfer is started
+    virtual bool render(ws2811_led_t *const *channels) = 0;
+
+    /// block until previous transfer is done
+    virtual bool wait() = 0;
+
+    /// reinit only if leds count changed
+    bool resize(size_t count)
+    {
+        if (count == ledsCount())
+            return true;
+        fini();
+        return init(count);
+    }
+};
+
+class SpiOutput {
+public:
+    virtual ~SpiOutput() {}
+
+    virtual bool init(const std::string &device) = 0;
+
+    /// blocks until ledsNumber leds of buffer are written out
+    virtual bool send(sk9822_buffer &buf, size_t ledsNumber) = 0;
+};
+
+class GpioOutput {
+public:
+    virtual ~GpioOutput() {}
+
+    virtual bool init() = 0;
+    virtual void setOutput(int pin) = 0;
+    virtual void write(int pin, bool high) = 0;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,140 @@
+//
+// Output backends for Raspberry Pi: rpi_ws281x PWM/DMA, spidev and wiringPi GPIO
+//
+
+#pragma once
+
+#include "../AsyncLog.h"
+#include "../easylogging++.h"
+#include "../spi/SpiOut.h"
+#include "Output.h"
+#include <wiringPi.h>
+#include <wiringPiSPI.h>
+
+// WS281X lib options
+#define GPIO_PIN_1 12 // 21//12
+#define GPIO_PIN_2 13
+#define DMA 10
+#define STRIP_TYPE WS2811_STRIP_RGB // WS2812/SK6812RGB integrated chip+leds
+//#define STRIP_TYPE SK6812_STRIP_RGBW // SK6812RGBW
+
+namespace LedMapper {
+
+class Ws2811Output : public WsOutput {
+public:
+    Ws2811Output()
+        : m_inited(false)
+    {
+        memset(&m_ledstring, 0, sizeof(m_ledstring));
+    }
+
+    ~Ws2811Output()
+    {
+        if (m_inited)
+            fini();
+    }
+
+    bool init(size_t ledsCount) override
+    {
+        m_ledstring.render_wait_time = 0;
+        m_ledstring.freq = WS2811_TARGET_FREQ;
+        m_ledstring.dmanum = DMA;
+        /// channel params sequence must fit its arrangement in ws2811_channel_t
+        m_ledstring.channel[0] = {
+            GPIO_PIN_1, // gpionum
+            0, // invert
+            static_cast<int>(ledsCount), // count
+            STRIP_TYPE, // strip_type
+            nullptr, // leds, allocated by ws2811_init
+            255, // brightness
+        };
+        m_ledstring.channel[1] = {
+            GPIO_PIN_2, // gpionum
+            0, // invert
+            static_cast<int>(ledsCount), // count
+            STRIP_TYPE, // strip_type
+            nullptr, // leds, allocated by ws2811_init
+            255, // brightness
+        };
+
+        ws2811_return_t ret;
+        if ((ret = ws2811_init(&m_ledstring)) != WS2811_SUCCESS) {
+            LOG(ERROR) << "ws2811_init failed: \n" << ws2811_get_return_t_str(ret);
+            return false;
+        }
+        for (size_t chan = 0; chan < WS_OUTPUT_CHANNELS; ++chan)
+            m_libLeds[chan] = m_ledstring.channel[chan].leds;
+        m_inited = true;
+        return true;
+    }
+
+    void fini() override
+    {
+        if (!m_inited)
+            return;
+        for (size_t chan = 0; chan < WS_OUTPUT_CHANNELS; ++chan)
+            m_ledstring.channel[chan].leds = m_libLeds[chan];
+        ws2811_fini(&m_ledstring);
+        m_inited = false;
+    }
+
+    size_t ledsCount() const override { return m_inited ? m_ledstring.channel[0].count : 0; }
+
+    bool render(ws2811_led_t *const *channels) override
+    {
+        /// latch arrays as render source
+        for (size_t chan = 0; chan < WS_OUTPUT_CHANNELS; ++chan)
+            m_ledstring.channel[chan].leds = channels[chan];
+        ws2811_return_t ret = ws2811_render(&m_ledstring);
+        if (ret != WS2811_SUCCESS) {
+            LOG_ASYNC(ERROR, "ws2811_render failed: {}", ws2811_get_return_t_str(ret));
+            return false;
+        }
+        return true;
+    }
+
+    bool wait() override
+    {
+        ws2811_return_t ret = ws2811_wait(&m_ledstring);
+        if (ret != WS2811_SUCCESS) {
+            LOG_ASYNC(ERROR, "ws2811_wait failed: {}", ws2811_get_return_t_str(ret));
+            return false;
+        }
+        return true;
+    }
+
+private:
+    ws2811_t m_ledstring;
+    /// leds arrays are allocated by ws2811 lib, render points channels to external arrays,
+    /// so lib arrays have to be put back before ws2811_fini frees them
+    ws2811_led_t *m_libLeds[WS_OUTPUT_CHANNELS];
+    bool m_inited;
+};
+
+class SpiDevOutput : public SpiOutput {
+public:
+    bool init(const std::string &device) override { return m_spi.init(device); }
+
+    bool send(sk9822_buffer &buf, size_t ledsNumber) override { return m_spi.send(buf, ledsNumber); }
+
+private:
+    SpiOut m_spi;
+};
+
+class WiringPiGpio : public GpioOutput {
+public:
+    bool init() override
+    {
+        if (wiringPiSetupGpio() != 0) {
+            LOG(ERROR) << "Failed to init wiringPi SPI";
+            return false;
+        }
+        return true;
+    }
+
+    void setOutput(int pin) override { pinMode(pin, OUTPUT); }
+
+    void write(int pin, bool high) override { digitalWrite(pin, high ? HIGH : LOW); }
+};
+
+} // namespace LedMapper
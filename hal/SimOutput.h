@@ -0,0 +1,189 @@
+//
+// Simulated output backends: no hardware access, output blocks for modelled wire time
+// and frames are recorded to memory and optionally to a file, so the whole
+// receive -> render path runs and can be profiled on any Linux box
+//
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../easylogging++.h"
+#include "Output.h"
+
+namespace LedMapper {
+
+/// Keeps last frame and frames counter per output channel,
+/// appends every frame to file as { u64 ns, u8 kind, u8 chan, u32 size, data } if path is given
+class FrameRecorder {
+public:
+    enum Kind : uint8_t { WS = 0, SPI = 1 };
+
+    explicit FrameRecorder(const char *path = nullptr)
+        : m_file(nullptr)
+        , m_frames(0)
+    {
+        if (path && (m_file = fopen(path, "wb")) == nullptr)
+            LOG(ERROR) << "Failed to open frames record file " << path;
+    }
+
+    ~FrameRecorder()
+    {
+        if (m_file)
+            fclose(m_file);
+    }
+
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+    void record(Kind kind, uint8_t chan, const void *data, uint32_t size)
+    {
+        auto &last = m_last[std::make_pair(kind, chan)];
+        last.assign(static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+        ++m_frames;
+        if (!m_file)
+            return;
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        fwrite(&ns, sizeof(ns), 1, m_file);
+        fwrite(&kind, sizeof(kind), 1, m_file);
+        fwrite(&chan, sizeof(chan), 1, m_file);
+        fwrite(&size, sizeof(size), 1, m_file);
+        fwrite(data, 1, size, m_file);
+    }
+
+    size_t frames() const { return m_frames; }
+
+    const std::vector<uint8_t> &last(Kind kind, uint8_t chan) { return m_last[std::make_pair(kind, chan)]; }
+
+private:
+    FILE *m_file;
+    size_t m_frames;
+    std::map<std::pair<uint8_t, uint8_t>, std::vector<uint8_t>> m_last;
+};
+
+/// WS281x at 800kHz: 24 bits per led take 30us plus reset time after frame
+class SimWsOutput : public WsOutput {
+public:
+    static constexpr int64_t LED_WIRE_TIME_US = 30;
+    static constexpr int64_t RESET_TIME_US = 300;
+
+    explicit SimWsOutput(FrameRecorder &recorder)
+        : m_recorder(recorder)
+        , m_ledsCount(0)
+    {
+    }
+
+    bool init(size_t ledsCount) override
+    {
+        m_ledsCount = ledsCount;
+        m_busyUntil = std::chrono::steady_clock::now();
+        LOG(INFO) << "Simulated WS output with leds=" << ledsCount;
+        return true;
+    }
+
+    void fini() override { wait(); }
+
+    size_t ledsCount() const override { return m_ledsCount; }
+
+    bool render(ws2811_led_t *const *channels) override
+    {
+        /// as ws2811_render: wait for previous DMA, then start next one
+        wait();
+        for (size_t chan = 0; chan < WS_OUTPUT_CHANNELS; ++chan)
+            m_recorder.record(FrameRecorder::WS, chan, channels[chan], m_ledsCount * sizeof(ws2811_led_t));
+        m_busyUntil = std::chrono::steady_clock::now()
+                      + std::chrono::microseconds(LED_WIRE_TIME_US * m_ledsCount + RESET_TIME_US);
+        return true;
+    }
+
+    bool wait() override
+    {
+        std::this_thread::sleep_until(m_busyUntil);
+        return true;
+    }
+
+private:
+    FrameRecorder &m_recorder;
+    size_t m_ledsCount;
+    std::chrono::steady_clock::time_point m_busyUntil;
+};
+
+/// SPI at clock of spi_init(), blocking write as send_buffer()
+class SimSpiOutput : public SpiOutput {
+public:
+    static constexpr double SPI_CLOCK_HZ = 3.90625 * 1000 * 1000;
+
+    explicit SimSpiOutput(FrameRecorder &recorder)
+        : m_recorder(recorder)
+        , m_channel(0)
+    {
+    }
+
+    bool init(const std::string &device) override
+    {
+        LOG(INFO) << "Simulated SPI output instead of " << device;
+        return true;
+    }
+
+    bool send(sk9822_buffer &buf, size_t ledsNumber) override
+    {
+        if (ledsNumber > buf.leds)
+            ledsNumber = buf.leds;
+        if (ledsNumber == 0)
+            return true;
+        /// start frame + leds + end frame words, see send_buffer()
+        const size_t bytes = (ledsNumber + 3 + (ledsNumber - 1) / 64) * sizeof(sk9822_color);
+        m_recorder.record(FrameRecorder::SPI, m_channel, buf.pixels, ledsNumber * sizeof(sk9822_color));
+        std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<int64_t>(bytes * 8 * 1e9 / SPI_CLOCK_HZ)));
+        return true;
+    }
+
+    /// SPI channel is selected by GPIO mux, SimGpio forwards it here to tag recorded frames
+    void selectChannel(uint8_t chan) { m_channel = chan; }
+
+private:
+    FrameRecorder &m_recorder;
+    uint8_t m_channel;
+};
+
+/// Keeps pin states, optionally reports writes of one pin to callback
+class SimGpio : public GpioOutput {
+public:
+    bool init() override
+    {
+        LOG(INFO) << "Simulated GPIO";
+        return true;
+    }
+
+    void setOutput(int pin) override { m_pins[pin] = false; }
+
+    void write(int pin, bool high) override
+    {
+        m_pins[pin] = high;
+        if (m_onWrite)
+            m_onWrite(pin, high);
+    }
+
+    bool read(int pin) const
+    {
+        auto state = m_pins.find(pin);
+        return state != m_pins.end() && state->second;
+    }
+
+    void onWrite(std::function<void(int, bool)> callback) { m_onWrite = std::move(callback); }
+
+private:
+    std::map<int, bool> m_pins;
+    std::function<void(int, bool)> m_onWrite;
+};
+
+} // namespace LedMapper
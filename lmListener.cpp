@@ -5,24 +5,48 @@
 //
 */
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <signal.h>
+#include <sstream>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
+#include "ArtNet.h"
+#include "AsyncLog.h"
+#include "Ddp.h"
+#include "EventLoop.h"
+#include "FrameAssembler.h"
+#include "FrameSequence.h"
+#include "FrameTrace.h"
+#include "FrameView.h"
+#include "LatencyHistogram.h"
+#include "MetricsServer.h"
+#include "PipelineStats.h"
+#include "PixelConvert.h"
+#include "Probes.h"
+#include "Sacn.h"
+#include "SocketFilter.h"
+#include "TripleBuffer.h"
 #include "UdpManager.h"
-#include "rpi_ws281x/ws2811.h"
+#include "hal/Output.h"
 #include "spi/SpiOut.h"
-#include <wiringPi.h>
-#include <wiringPiSPI.h>
+#ifdef LM_SIM_OUTPUT
+#include "hal/SimOutput.h"
+#else
+#include "hal/RealOutput.h"
+#endif
 
 #include "easylogging++.h"
 INITIALIZE_EASYLOGGINGPP
@@ -31,20 +55,55 @@ using microseconds = std::chrono::microseconds;
 using milliseconds = std::chrono::milliseconds;
 using namespace std::chrono_literals;
 
-// WS281X lib options
-#define GPIO_PIN_1 12 // 21//12
-#define GPIO_PIN_2 13
-#define DMA 10
-#define STRIP_TYPE WS2811_STRIP_RGB // WS2812/SK6812RGB integrated chip+leds
-//#define STRIP_TYPE SK6812_STRIP_RGBW // SK6812RGBW
-
-constexpr size_t MAX_CHANNELS = 2;
+constexpr size_t MAX_CHANNELS = LedMapper::WS_OUTPUT_CHANNELS;
 constexpr size_t LED_COUNT_WS = 1000;
+constexpr size_t WS_LEDS_COUNT_STEP = 50;
+constexpr size_t WS_SHRINK_AFTER_FRAMES = 30; // frames in a row which need less WS leds before output shrinks
 constexpr size_t LED_COUNT_SPI = 2000;
 constexpr size_t MAX_SENDBUFFER_SIZE = 4096 * 3; // 2 SPI channels RGB
+constexpr size_t FRAGMENT_POOL_SIZE = 4; // fragmented frames in reassembly at once
+constexpr milliseconds FRAGMENT_TIMEOUT{ 50 }; // incomplete fragmented frames are dropped after it
+/// this many late sequenced frames in a row are taken as sender restart
+constexpr size_t FRAME_SEQUENCE_RESYNC = 4;
+/// parity accumulator per fragmented frame, enough for frame of all SPI leds split into any fragments
+constexpr size_t FRAGMENT_PARITY_BYTES = MAX_CHANNELS * LED_COUNT_SPI * 3 + 2 * MAX_SENDBUFFER_SIZE;
+constexpr int MAX_FRAMES_BATCH = 8; // frames drained from socket with one syscall
+/// drop stale frames queued in socket and render only the newest one from each batch
+constexpr bool RENDER_LATEST_FRAME_ONLY = true;
+/// WS render returns right after DMA start, so DMA of frame N overlaps conversion of frame N+1
+/// in receiver thread. With this mode render thread waits for DMA end before taking frame from mailbox,
+/// instead of blocking in render with a frame which got stale during wait
+constexpr bool WS_LATCH_AFTER_DMA = true;
+
+/// Art-Net and sACN universes laid out channel by channel. By default each channel takes enough universes
+/// for all WS leds, so sACN groups of all channels and sync universe fit into default
+/// net.ipv4.igmp_max_memberships=20. LM_DMX_UNIVERSES_PER_CHANNEL maps more, up to all SPI leds
+constexpr uint16_t DMX_PIXELS_PER_UNIVERSE = LedMapper::DMX_SLOTS / 3;
+constexpr uint16_t DMX_UNIVERSES_PER_CHANNEL = (LED_COUNT_WS + DMX_PIXELS_PER_UNIVERSE - 1) / DMX_PIXELS_PER_UNIVERSE;
+constexpr uint16_t DMX_MAX_UNIVERSES_PER_CHANNEL
+    = (LED_COUNT_SPI + DMX_PIXELS_PER_UNIVERSE - 1) / DMX_PIXELS_PER_UNIVERSE;
+static_assert(MAX_CHANNELS * DMX_UNIVERSES_PER_CHANNEL + 1 <= 20,
+              "default sACN mapping must fit into default net.ipv4.igmp_max_memberships");
+constexpr uint16_t ARTNET_FIRST_UNIVERSE = 0;
+constexpr std::chrono::seconds ARTNET_SYNC_TIMEOUT{ 4 };
+constexpr uint16_t SACN_FIRST_UNIVERSE = 1; // E1.31 universes start from 1
+constexpr std::chrono::milliseconds SACN_SOURCE_TIMEOUT{ 2500 }; // E1.31 network data loss timeout
+constexpr std::chrono::milliseconds SACN_SYNC_TIMEOUT{ 2500 };
+/// DDP pixel data of channels follows each other, every channel takes room for all SPI leds
+constexpr size_t DDP_LEDS_PER_CHANNEL = LED_COUNT_SPI;
+
+/// pipeline counters are logged with this period
+constexpr std::chrono::seconds STATS_LOG_PERIOD{ 60 };
+
+/// trace events kept per thread when tracing is enabled by LM_TRACE_FILE, about 2 MB each
+constexpr size_t TRACE_EVENTS = 1 << 16;
+
+/// drop datagrams of foreign protocols and unmapped universes in kernel with BPF socket filters
+constexpr bool USE_SOCKET_FILTERS = true;
 
 constexpr int FRAME_IN_PORT = 3001;
 constexpr int STRIP_TYPE_PORT = 3002;
+constexpr int METRICS_PORT = 9102; // Prometheus text format over HTTP, 0 disables
 
 std::atomic<bool> continue_looping{ true };
 int clear_on_exit = 0;
@@ -63,61 +122,57 @@ enum { TYPE_WS281X, TYPE_SK9822 };
 
 static std::map<std::string, int> s_ledTypeToEnum = { { "WS281X", TYPE_WS281X }, { "SK9822", TYPE_SK9822 } };
 
-bool initGPIO()
+bool initGPIO(LedMapper::GpioOutput &gpio)
 {
-    if (wiringPiSetupGpio() != 0) {
-        LOG(ERROR) << "Failed to init wiringPi SPI";
+    if (!gpio.init())
         return false;
-    }
-    for (auto &gpio : s_gpioSwitches) {
-        pinMode(gpio.first, OUTPUT);
-        LOG(INFO) << "Pin #" << std::to_string(gpio.first) << " -> " << (gpio.second ? "HIGH" : "LOW");
-        digitalWrite(gpio.first, (gpio.second ? HIGH : LOW));
+    for (auto &pin : s_gpioSwitches) {
+        gpio.setOutput(pin.first);
+        LOG(INFO) << "Pin #" << std::to_string(pin.first) << " -> " << (pin.second ? "HIGH" : "LOW");
+        gpio.write(pin.first, pin.second);
     }
 
     LOG(INFO) << "GPIO Inited";
     return true;
 }
 
-ws2811_led_t *ledsWs1, *ledsWs2;
-
-bool initWS(ws2811_t &ledstring)
+/// DMA buffer and wire time of WS output scale with channel leds count set on init,
+/// so frames with less leds reinit output with count rounded up to WS_LEDS_COUNT_STEP
+size_t wsLedsCount(size_t ledsInChannel)
 {
-    ledsWs1 = (ws2811_led_t *)malloc(sizeof(ws2811_led_t) * LED_COUNT_WS);
-    ledsWs2 = (ws2811_led_t *)malloc(sizeof(ws2811_led_t) * LED_COUNT_WS);
-
-    ledstring.render_wait_time = 0;
-    ledstring.freq = WS2811_TARGET_FREQ;
-    ledstring.dmanum = DMA;
-    /// channel params sequence must fit its arrangement in ws2811_channel_t
-    ledstring.channel[0] = {
-        GPIO_PIN_1, // gpionum
-        0, // invert
-        LED_COUNT_WS, // count
-        STRIP_TYPE, // strip_type
-        ledsWs1,
-        255, // brightness
-    };
-    ledstring.channel[1] = {
-        GPIO_PIN_2, // gpionum
-        0, // invert
-        LED_COUNT_WS, // count
-        STRIP_TYPE, // strip_type
-        ledsWs2,
-        255, // brightness
-    };
+    size_t count = (ledsInChannel + WS_LEDS_COUNT_STEP - 1) / WS_LEDS_COUNT_STEP * WS_LEDS_COUNT_STEP;
+    return std::max(WS_LEDS_COUNT_STEP, std::min(count, LED_COUNT_WS));
+}
 
-    ws2811_return_t ret;
-    if ((ret = ws2811_init(&ledstring)) != WS2811_SUCCESS) {
-        LOG(ERROR) << "ws2811_init failed: \n" << ws2811_get_return_t_str(ret);
-        return false;
+///
+/// WS leds count to render frames with: grows right away, shrinks only after WS_SHRINK_AFTER_FRAMES frames
+/// in a row needed less, so sender which alternates across step border doesn't reinit output every frame
+///
+class WsLedsCounter {
+public:
+    size_t next(size_t current, size_t ledsInChannel)
+    {
+        const size_t count = wsLedsCount(ledsInChannel);
+        if (count >= current) {
+            m_smallerFrames = 0;
+            return count;
+        }
+        m_shrinkTo = m_smallerFrames == 0 ? count : std::max(m_shrinkTo, count);
+        if (++m_smallerFrames < WS_SHRINK_AFTER_FRAMES)
+            return current;
+        m_smallerFrames = 0;
+        return m_shrinkTo;
     }
-    return true;
+
+private:
+    size_t m_smallerFrames = 0;
+    size_t m_shrinkTo = 0; // largest count of frames in current run of smaller ones
 };
 
 struct GpioOutSwitcher {
-    GpioOutSwitcher()
-        : m_isWs(false)
+    GpioOutSwitcher(LedMapper::GpioOutput &gpio)
+        : m_gpio(gpio)
+        , m_isWs(false)
     {
         switchWsOut(true);
     }
@@ -128,10 +183,11 @@ struct GpioOutSwitcher {
             return;
         LOG(DEBUG) << "switch to WS = " << isWS;
         m_isWs = isWS;
-        digitalWrite(PIN_SWITCH_1, m_isWs ? LOW : HIGH);
-        digitalWrite(PIN_SWITCH_2, m_isWs ? LOW : HIGH);
+        m_gpio.write(PIN_SWITCH_1, !m_isWs);
+        m_gpio.write(PIN_SWITCH_2, !m_isWs);
         std::this_thread::sleep_for(milliseconds(500));
     }
+    LedMapper::GpioOutput &m_gpio;
     bool m_isWs;
 };
 
@@ -161,8 +217,11 @@ double rgb2hue(uint8_t r, uint8_t g, uint8_t b)
     return hue;
 }
 
-void testAnim(ws2811_t &wsOut, size_t &cntr)
+void testAnim(LedMapper::WsOutput &wsOut, size_t &cntr)
 {
+    static ws2811_led_t leds[MAX_CHANNELS][LED_COUNT_WS];
+    static ws2811_led_t *channels[MAX_CHANNELS] = { leds[0], leds[1] };
+
     char val = static_cast<char>(static_cast<float>(cntr * 2));
 
     if (cntr > 126)
@@ -170,24 +229,209 @@ void testAnim(ws2811_t &wsOut, size_t &cntr)
     if (cntr > 130)
         cntr = 0;
 
-    for (size_t i = 0; i < LED_COUNT_WS; ++i)
-        wsOut.channel[0].leds[i] = (val << 16) | (val << 8) | val;
+    for (size_t i = 0; i < wsOut.ledsCount(); ++i)
+        leds[0][i] = (val << 16) | (val << 8) | val;
+
+    wsOut.render(channels);
+}
+
+/// Frame converted to output wire formats, handed over from receiver to render thread through FrameMailbox.
+/// Render thread outputs pixel arrays of the slot directly, so pixels are never copied
+struct OutputFrame {
+    OutputFrame()
+    {
+        for (auto &buf : spi) {
+            if (sk9822_init(&buf, LED_COUNT_SPI) < 0)
+                LOG(ERROR) << "SPI Pixel buffer initialization error: Not enough memory.";
+        }
+    }
+    ~OutputFrame()
+    {
+        for (auto &buf : spi)
+            sk9822_free(&buf);
+    }
+    OutputFrame(const OutputFrame &) = delete;
+    OutputFrame &operator=(const OutputFrame &) = delete;
+
+    bool isWS = true;
+    size_t channels = 0;
+    size_t maxLedsInChannel = 0;
+    uint16_t ledsInChannel[MAX_CHANNELS];
+    ws2811_led_t ws[MAX_CHANNELS][LED_COUNT_WS];
+    sk9822_buffer spi[MAX_CHANNELS];
+    /// kernel receive and header parse of last datagram of frame, handover to render thread
+    LedMapper::LatencyClock::time_point received, parsed, converted;
+};
+
+/// one producer slot per fragmented frame in reassembly plus one for single datagram frames,
+/// one for Art-Net, one for sACN and one for DDP
+using FrameMailbox = LedMapper::TripleBuffer<OutputFrame, FRAGMENT_POOL_SIZE + 4>;
+using FrameAssembler = LedMapper::FrameAssembler<FRAGMENT_POOL_SIZE>;
+constexpr size_t SINGLE_FRAME_SLOT = FRAGMENT_POOL_SIZE;
+constexpr size_t ARTNET_FRAME_SLOT = FRAGMENT_POOL_SIZE + 1;
+constexpr size_t SACN_FRAME_SLOT = FRAGMENT_POOL_SIZE + 2;
+constexpr size_t DDP_FRAME_SLOT = FRAGMENT_POOL_SIZE + 3;
 
-    ws2811_return_t wsReturnStat = ws2811_render(&wsOut);
-    if (wsReturnStat != WS2811_SUCCESS) {
-        LOG(ERROR) << "ws2811_render failed: " << ws2811_get_return_t_str(wsReturnStat);
+///
+/// Copy layout, timing and converted pixels of channels into another frame
+///
+void copyFrame(const OutputFrame &from, OutputFrame &to)
+{
+    to.isWS = from.isWS;
+    to.channels = from.channels;
+    to.maxLedsInChannel = from.maxLedsInChannel;
+    to.received = from.received;
+    to.parsed = from.parsed;
+    for (size_t chan = 0; chan < from.channels; ++chan) {
+        to.ledsInChannel[chan] = from.ledsInChannel[chan];
+        if (from.isWS)
+            memcpy(to.ws[chan], from.ws[chan],
+                   std::min<size_t>(from.ledsInChannel[chan], LED_COUNT_WS) * sizeof(ws2811_led_t));
+        else
+            memcpy(to.spi[chan].pixels, from.spi[chan].pixels,
+                   std::min<size_t>(from.ledsInChannel[chan], to.spi[chan].leds) * sizeof(sk9822_color));
     }
 }
 
-void stop_program(int sig)
+///
+/// DMX universes input state: universes are written into staging frame which keeps pixels of universes
+/// not resent since last frame, it is copied into own mailbox slot on publish, as that slot holds
+/// an older frame after publish. Channel leds count is the furthest led any universe reached so far,
+/// so it doesn't jump on lost universes
+///
+struct UniverseInput {
+    UniverseInput(const LedMapper::UniverseMapping &mapping, size_t slot,
+                  LedMapper::UniverseFrame::Clock::duration syncTimeout)
+        : frame(mapping, syncTimeout)
+        , slot(slot)
+        , staging(std::make_unique<OutputFrame>())
+    {
+    }
+
+    LedMapper::UniverseFrame frame;
+    size_t slot;
+    std::unique_ptr<OutputFrame> staging;
+    uint16_t leds[MAX_CHANNELS] = {};
+};
+
+///
+/// Convert count pixels into channel output buffer starting from firstLed
+///
+void convertChannel(OutputFrame &frame, size_t chan, size_t firstLed, const uint8_t *rgb, size_t count)
 {
-    /* Ignore the signal */
-    signal(sig, SIG_IGN);
-    /* stop the looping */
-    continue_looping.store(false);
-    /* Put the ctrl-c to default action in case something goes wrong */
-    signal(sig, SIG_DFL);
+    if (frame.isWS) {
+        if (firstLed < LED_COUNT_WS)
+            LedMapper::rgb24ToWs(rgb, frame.ws[chan] + firstLed, std::min(count, LED_COUNT_WS - firstLed));
+    }
+    else {
+        /// SPI pixels go straight into wire format, framing words are kept in buffer
+        SpiOut::writeSpan(frame.spi[chan], firstLed, rgb, count);
+    }
 }
+
+///
+/// Convert count pixels, which start at firstPixel of frame pixels of all channels, into channels output buffers
+///
+void convertPixels(OutputFrame &frame, size_t firstPixel, const uint8_t *rgb, size_t count)
+{
+    size_t curChannel, chanPixelOffset = 0, begin, end;
+
+    for (curChannel = 0; curChannel < frame.channels; ++curChannel) {
+        /// part of pixels span which belongs to channel
+        begin = std::max(firstPixel, chanPixelOffset);
+        end = std::min(firstPixel + count, chanPixelOffset + frame.ledsInChannel[curChannel]);
+        if (begin < end)
+            convertChannel(frame, curChannel, begin - chanPixelOffset, rgb + (begin - firstPixel) * 3, end - begin);
+        chanPixelOffset += frame.ledsInChannel[curChannel];
+    }
+}
+
+///
+/// Take channel layout from frame view and convert its channel spans into frame output buffers
+///
+void parseFrame(const LedMapper::FrameView &view, bool isWS, OutputFrame &frame)
+{
+    size_t curChannel;
+    LedMapper::PixelSpan span;
+
+    frame.isWS = isWS;
+    frame.channels = std::min(view.channels(), MAX_CHANNELS);
+    frame.maxLedsInChannel = 0;
+
+    for (curChannel = 0; curChannel < frame.channels; ++curChannel) {
+        frame.ledsInChannel[curChannel] = view.ledsInChannel(curChannel);
+        frame.maxLedsInChannel = std::max<size_t>(frame.maxLedsInChannel, frame.ledsInChannel[curChannel]);
+        span = view.channel(curChannel);
+        convertChannel(frame, curChannel, 0, span.rgb, span.count);
+    }
+}
+
+///
+/// Set layout of fragmented frame from fragment header and convert fragment payload into frame output buffers
+///
+void parseFragment(const LedMapper::FragmentHeader &header, const uint8_t *payload, size_t payloadSize, bool isWS,
+                   OutputFrame &frame)
+{
+    frame.isWS = isWS;
+    frame.channels = std::min(LedMapper::FRAGMENT_HEADER_CHANNELS, MAX_CHANNELS);
+    frame.maxLedsInChannel = 0;
+    for (size_t chan = 0; chan < frame.channels; ++chan) {
+        frame.ledsInChannel[chan] = header.ledsInChannel[chan];
+        frame.maxLedsInChannel = std::max<size_t>(frame.maxLedsInChannel, frame.ledsInChannel[chan]);
+    }
+    convertPixels(frame, header.byteOffset / 3, payload, payloadSize / 3);
+}
+
+/// WS output failures are fatal as output is reinited, SPI writes failed for one frame may pass for next one
+enum class RenderResult { Rendered, Failed, Fatal };
+
+///
+/// Render frame buffers through WS or SPI output
+///
+RenderResult renderFrame(OutputFrame &frame, LedMapper::WsOutput &wsOut, WsLedsCounter &wsLeds,
+                         LedMapper::SpiOutput &spiOut, LedMapper::GpioOutput &gpio, LedMapper::TraceRing &trace)
+{
+    size_t curChannel;
+
+    if (frame.isWS) {
+        LedMapper::TraceScope scope(trace, "ws_render", frame.maxLedsInChannel);
+        if (!wsOut.resize(wsLeds.next(wsOut.ledsCount(), frame.maxLedsInChannel)))
+            return RenderResult::Fatal;
+        ws2811_led_t *channels[MAX_CHANNELS];
+        /// slots are reused, so leds past channel's own count up to rendered count are cleared,
+        /// otherwise they show pixels of frame which used the slot before
+        size_t channelLeds;
+        for (curChannel = 0; curChannel < MAX_CHANNELS; ++curChannel) {
+            channelLeds = curChannel < frame.channels ? frame.ledsInChannel[curChannel] : 0;
+            if (channelLeds < wsOut.ledsCount())
+                std::fill(frame.ws[curChannel] + channelLeds, frame.ws[curChannel] + wsOut.ledsCount(), 0);
+            channels[curChannel] = frame.ws[curChannel];
+        }
+        if (!wsOut.render(channels))
+            return RenderResult::Fatal;
+        // LOG(DEBUG) << "leds send:" << frame.ledsInChannel[0];
+    }
+    else {
+        bool sent = true;
+        for (curChannel = 0; curChannel < frame.channels; ++curChannel) {
+            if (frame.ledsInChannel[curChannel] == 0)
+                continue;
+            LedMapper::TraceScope scope(trace, "spi_write", curChannel);
+            gpio.write(PIN_SWITCH_SPI, curChannel == 0);
+            if (!spiOut.send(frame.spi[curChannel],
+                             std::min<size_t>(frame.ledsInChannel[curChannel], LED_COUNT_SPI))) {
+                LOG_ASYNC(ERROR, "SPI send of channel={} failed", curChannel);
+                sent = false;
+            }
+        }
+        LedMapper::TraceScope scope(trace, "spi_latch", frame.maxLedsInChannel);
+        std::this_thread::sleep_for(microseconds(frame.maxLedsInChannel));
+        if (!sent)
+            return RenderResult::Failed;
+    }
+    return RenderResult::Rendered;
+}
+
 ///
 /// Main : init SPI, GPIO and WS interfaces, create lister on localhost:FRAME_IN_PORT
 /// receive UDP frames and route them to LEDs through right outputs on Shield
@@ -201,161 +445,617 @@ int main()
     el::Loggers::reconfigureAllLoggers(el::ConfigurationType::ToStandardOutput, "true");
     el::Loggers::reconfigureAllLoggers(el::ConfigurationType::MaxLogFileSize, "4096");
 
+    /// Event loop owns all descriptors: frame and type sockets, signals and timers.
+    /// Signals are blocked and routed to signalfd before any other thread starts
+    LedMapper::EventLoop loop;
+    if (!loop.isValid())
+        exit(1);
+    loop.addSignals({ SIGINT, SIGTERM }, [&loop](int sig) {
+        LOG(INFO) << "Got signal " << sig;
+        continue_looping.store(false);
+        loop.stop();
+    });
+
+    /// per-stage tracing of receiver and render threads, dumped as Chrome trace JSON on SIGUSR1 and at exit
+    const char *traceFile = getenv("LM_TRACE_FILE");
+    LedMapper::TraceRing receiveTrace("receive", traceFile ? TRACE_EVENTS : 0);
+    LedMapper::TraceRing renderTrace("render", traceFile ? TRACE_EVENTS : 0);
+    auto dumpTrace = [&]() {
+        std::ofstream out(traceFile);
+        LedMapper::writeChromeTrace(out, { &receiveTrace, &renderTrace });
+        if (out)
+            LOG(INFO) << "Trace written to " << traceFile;
+        else
+            LOG(ERROR) << "Failed to write trace to " << traceFile;
+    };
+    if (traceFile)
+        loop.addSignals({ SIGUSR1 }, [&](int) { dumpTrace(); });
+
+    /// LOG_ASYNC records of receive and render paths are formatted on own thread from here on
+    LedMapper::AsyncLog::instance().start();
+
+    /// Output backends, simulated ones model wire time and record frames instead of driving hardware
+#ifdef LM_SIM_OUTPUT
+    LedMapper::FrameRecorder recorder(getenv("LM_SIM_RECORD_FILE"));
+    LedMapper::SimWsOutput wsOut(recorder);
+    LedMapper::SimSpiOutput spiOut(recorder);
+    LedMapper::SimGpio gpio;
+    gpio.onWrite([&spiOut](int pin, bool high) {
+        if (pin == PIN_SWITCH_SPI)
+            spiOut.selectChannel(high ? 0 : 1);
+    });
+#else
+    LedMapper::Ws2811Output wsOut;
+    LedMapper::SpiDevOutput spiOut;
+    LedMapper::WiringPiGpio gpio;
+#endif
+
     /// WS (one wire) output setup
-    ws2811_t wsOut;
-    ws2811_return_t wsReturnStat;
-    if (!initWS(wsOut)) {
+    if (!wsOut.init(LED_COUNT_WS)) {
         exit(1);
     }
 
-    SpiOut spiOut;
+    /// SPI pixel buffers are owned by frame mailbox slots
     if (!spiOut.init(s_spiDevice))
         exit(1);
-    /// add two channels to spi out,
-    /// further can select kind of channel for different ICs
-    spiOut.addChannel(LED_COUNT_SPI);
-    spiOut.addChannel(LED_COUNT_SPI);
 
-    if (!initGPIO())
+    if (!initGPIO(gpio))
         exit(1);
 
     /// UDP listeners setup
     LedMapper::UdpSettings udpConf;
     udpConf.receiveOn(FRAME_IN_PORT);
     udpConf.receiveBufferSize = MAX_SENDBUFFER_SIZE;
+    udpConf.dropCounter = true;
+    udpConf.timestamps = true;
+    if (USE_SOCKET_FILTERS)
+        udpConf.filter = LedMapper::frameSocketFilter();
     auto frameInput = LedMapper::UdpManager();
     if (!frameInput.Setup(udpConf)) {
         LOG(ERROR) << "Failed to bind to port=" << FRAME_IN_PORT;
         exit(1);
     }
 
-    /// Init Gpio Multiplexer Switcher, LED Type selection listener thread and atomic isWS flag init
-    GpioOutSwitcher gpioSwitcher;
-    std::atomic<bool> isWS{ gpioSwitcher.m_isWs };
-
-    std::thread typeListener([&isWS]() {
-        LedMapper::UdpSettings udpConf;
-        udpConf.receiveOn(STRIP_TYPE_PORT);
-        auto typeInput = LedMapper::UdpManager();
-        if (!typeInput.Setup(udpConf)) {
-            LOG(ERROR) << "Failed to bind to port=" << STRIP_TYPE_PORT;
-            exit(1);
+    /// Art-Net, sACN and DDP are optional, listener works without them if port is taken
+    LedMapper::UniverseMapping artNetMapping;
+    artNetMapping.firstUniverse = ARTNET_FIRST_UNIVERSE;
+    artNetMapping.universesPerChannel = DMX_UNIVERSES_PER_CHANNEL;
+    if (const char *universes = getenv("LM_DMX_UNIVERSES_PER_CHANNEL")) {
+        const long value = strtol(universes, nullptr, 10);
+        if (value > 0 && value <= DMX_MAX_UNIVERSES_PER_CHANNEL)
+            artNetMapping.universesPerChannel = uint16_t(value);
+        else
+            LOG(WARNING) << "Ignored LM_DMX_UNIVERSES_PER_CHANNEL=" << universes << ", it takes 1.."
+                         << DMX_MAX_UNIVERSES_PER_CHANNEL;
+    }
+    artNetMapping.pixelsPerUniverse = DMX_PIXELS_PER_UNIVERSE;
+    artNetMapping.channels = MAX_CHANNELS;
+    LedMapper::UniverseMapping sacnMapping = artNetMapping;
+    sacnMapping.firstUniverse = SACN_FIRST_UNIVERSE;
+
+    LedMapper::UdpSettings artNetConf;
+    artNetConf.receiveOn(LedMapper::ARTNET_PORT);
+    artNetConf.broadcast = true;
+    artNetConf.dropCounter = true;
+    artNetConf.timestamps = true;
+    if (USE_SOCKET_FILTERS)
+        artNetConf.filter = LedMapper::artNetSocketFilter(artNetMapping.firstUniverse, artNetMapping.universes());
+    auto artNetInput = LedMapper::UdpManager();
+    const bool artNetEnabled = artNetInput.Setup(artNetConf);
+    if (!artNetEnabled)
+        LOG(WARNING) << "Failed to bind to Art-Net port=" << LedMapper::ARTNET_PORT << ", Art-Net input disabled";
+
+    LedMapper::UdpSettings ddpConf;
+    ddpConf.receiveOn(LedMapper::DDP_PORT);
+    ddpConf.receiveBufferSize = MAX_SENDBUFFER_SIZE;
+    ddpConf.dropCounter = true;
+    ddpConf.timestamps = true;
+    if (USE_SOCKET_FILTERS)
+        ddpConf.filter = LedMapper::ddpSocketFilter();
+    auto ddpInput = LedMapper::UdpManager();
+    const bool ddpEnabled = ddpInput.Setup(ddpConf);
+    if (!ddpEnabled)
+        LOG(WARNING) << "Failed to bind to DDP port=" << LedMapper::DDP_PORT << ", DDP input disabled";
+
+    /// sACN socket joins multicast groups of mapped universes only
+    char sacnGroup[16];
+    LedMapper::sacnMulticastAddress(SACN_FIRST_UNIVERSE, sacnGroup);
+    LedMapper::UdpSettings sacnConf;
+    sacnConf.receiveOn(sacnGroup, LedMapper::SACN_PORT);
+    sacnConf.multicast = true;
+    sacnConf.reuse = true;
+    sacnConf.dropCounter = true;
+    sacnConf.timestamps = true;
+    if (USE_SOCKET_FILTERS)
+        sacnConf.filter = LedMapper::sacnSocketFilter(sacnMapping.firstUniverse, sacnMapping.universes());
+    auto sacnInput = LedMapper::UdpManager();
+    const bool sacnEnabled = sacnInput.Setup(sacnConf);
+    /// kernel limits groups per socket by net.ipv4.igmp_max_memberships, 20 by default,
+    /// one of them is kept for sync universe which sender announces later
+    size_t sacnGroupsToJoin = sacnMapping.universes();
+    const int maxSacnGroups = LedMapper::UdpManager::GetMaxMcastMemberships();
+    if (sacnEnabled && maxSacnGroups > 1 && sacnGroupsToJoin >= size_t(maxSacnGroups)) {
+        sacnGroupsToJoin = maxSacnGroups - 1;
+        LOG(ERROR) << "sACN maps universes=" << sacnMapping.universes()
+                   << " but net.ipv4.igmp_max_memberships=" << maxSacnGroups << ", universes from "
+                   << SACN_FIRST_UNIVERSE + sacnGroupsToJoin << " are received only if sent unicast:"
+                   << " raise the sysctl or lower LM_DMX_UNIVERSES_PER_CHANNEL";
+    }
+    size_t sacnGroups = sacnEnabled ? 1 : 0;
+    for (size_t universe = 1; sacnEnabled && universe < sacnGroupsToJoin; ++universe) {
+        LedMapper::sacnMulticastAddress(SACN_FIRST_UNIVERSE + universe, sacnGroup);
+        if (sacnInput.JoinMcast(sacnGroup))
+            ++sacnGroups;
+    }
+    if (!sacnEnabled)
+        LOG(WARNING) << "Failed to bind to sACN port=" << LedMapper::SACN_PORT << ", sACN input disabled";
+    else if (sacnGroups < sacnGroupsToJoin)
+        LOG(WARNING) << "Joined sACN multicast groups=" << sacnGroups << " of " << sacnGroupsToJoin
+                     << ", rest of universes are received only if sent unicast";
+
+    LedMapper::UdpSettings typeConf;
+    typeConf.receiveOn(STRIP_TYPE_PORT);
+    auto typeInput = LedMapper::UdpManager();
+    if (!typeInput.Setup(typeConf)) {
+        LOG(ERROR) << "Failed to bind to port=" << STRIP_TYPE_PORT;
+        exit(1);
+    }
+
+    /// Init Gpio Multiplexer Switcher and isWS flag changed by LED Type selection messages
+    GpioOutSwitcher gpioSwitcher(gpio);
+    bool isWS = gpioSwitcher.m_isWs;
+
+    std::string currentType{ "" };
+    char typeMessage[6];
+    loop.add(typeInput.GetSocket(), [&]() {
+        if (typeInput.ReceiveDirect(typeMessage, 6) < 6)
+            return;
+        std::string type(typeMessage, 6);
+        if (currentType != type) {
+            currentType = type;
+            LOG(DEBUG) << "Got new type " << type;
+            isWS = s_ledTypeToEnum[type] == TYPE_WS281X;
         }
-        std::string currentType{ "" };
-        char message[6];
+    });
+
+    /// Receive and convert frames on event loop thread, output them on render thread,
+    /// converted frames go through lock-free triple buffer and render thread is woken by eventfd
+    auto frameMailbox = std::make_unique<FrameMailbox>();
+    int frameReadyFd = eventfd(0, EFD_CLOEXEC);
+    if (frameReadyFd < 0) {
+        LOG(ERROR) << "eventfd failed: " << errno << "-" << strerror(errno);
+        exit(1);
+    }
+    const uint64_t wakeUp = 1;
+    LedMapper::PipelineStats stats;
+    LedMapper::LatencyStats latency;
+
+    std::thread renderer([&]() {
+        uint64_t pending;
+        WsLedsCounter wsLeds;
         while (continue_looping.load()) {
-            if (typeInput.Receive(message, 6) < 6)
+            if (read(frameReadyFd, &pending, sizeof(pending)) != sizeof(pending))
+                continue;
+            if (WS_LATCH_AFTER_DMA && gpioSwitcher.m_isWs) {
+                LedMapper::TraceScope scope(renderTrace, "ws_wait");
+                wsOut.wait();
+            }
+            /// newest frame wins, frames published meanwhile were overwritten in mailbox
+            if (!frameMailbox->acquire())
+                continue;
+            OutputFrame &frame = frameMailbox->front();
+            if (frame.isWS != gpioSwitcher.m_isWs) {
+                LedMapper::TraceScope scope(renderTrace, "gpio_switch", frame.isWS);
+                gpioSwitcher.switchWsOut(frame.isWS);
+            }
+            const auto renderStart = LedMapper::LatencyClock::now();
+            LM_PROBE2(render_start, frame.isWS, frame.maxLedsInChannel);
+            const RenderResult result = renderFrame(frame, wsOut, wsLeds, spiOut, gpio, renderTrace);
+            if (result == RenderResult::Fatal) {
+                /// signals are routed to event loop, so this stops it
+                kill(getpid(), SIGTERM);
+                break;
+            }
+            if (result == RenderResult::Failed) {
+                stats.add(LedMapper::Counter::FramesRenderFailed);
                 continue;
-            std::string type(message, 6);
-            if (currentType != type) {
-                currentType = type;
-                LOG(DEBUG) << "Got new type " << type;
-                isWS.store(s_ledTypeToEnum[type] == TYPE_WS281X, std::memory_order_release);
             }
-        };
+            stats.add(LedMapper::Counter::FramesRendered);
+            LM_PROBE2(render_done, frame.isWS, frame.maxLedsInChannel);
+            const auto rendered = LedMapper::LatencyClock::now();
+            latency[LedMapper::LatencyStage::Receive].record(frame.parsed - frame.received);
+            latency[LedMapper::LatencyStage::Convert].record(frame.converted - frame.parsed);
+            latency[LedMapper::LatencyStage::Output].record(rendered - frame.converted);
+            latency[LedMapper::LatencyStage::Total].record(rendered - frame.received);
+            latency[frame.isWS ? LedMapper::LatencyStage::WsRender : LedMapper::LatencyStage::SpiSend].record(
+                rendered - renderStart);
+        }
     });
 
-    LOG(INFO) << "Inited ledMapper Listener";
-
-    /// break while loops on termination
-    signal(SIGINT, &stop_program);
-
-    size_t received = 0;
-    size_t i = 0;
-    size_t total_leds_num = 0, max_leds_in_chan;
-    size_t chan_cntr = 0, curChannel;
-    size_t headerByteOffset = 0, chanPixelOffset = 0;
-    uint16_t ledsInChannel[] = { 0, 0, 0, 0, 0, 0 };
-    char *pixels;
-    char message[MAX_SENDBUFFER_SIZE];
-
 #ifdef TEST_ANIMATION
     size_t animationCntr = 0;
-#endif
-
-    while (continue_looping.load()) {
-#ifdef TEST_ANIMATION
+    loop.addTimer(milliseconds(20), [&](uint64_t) {
         ++animationCntr;
         testAnim(wsOut, animationCntr);
-        continue;
-#endif
+    });
+#else
+    /// network inputs are received and converted on event loop thread
+    size_t received = 0;
+    int batched = 0, frameIdx = 0, newestSingleIdx = 0;
+    int frameSizes[MAX_FRAMES_BATCH];
+    timespec frameStamps[MAX_FRAMES_BATCH];
+    std::vector<char> frames(MAX_FRAMES_BATCH * MAX_SENDBUFFER_SIZE);
+    const char *message;
+    LedMapper::FrameView frameView;
+    FrameAssembler assembler(FRAGMENT_TIMEOUT, FRAGMENT_PARITY_BYTES);
+    LedMapper::FragmentHeader fragmentHeader;
+    LedMapper::RecoveredFragment recoveredFragment;
+    const uint8_t *fragmentPayload;
+    size_t fragmentPayloadSize = 0;
+    int fragmentSlot = -1;
+    LedMapper::FrameSequence frameSequence(FRAME_SEQUENCE_RESYNC);
+    size_t reportedLateFrames = 0;
+
+    /// datagram at frameIdx of current batch is going to be converted into frame
+    auto stampFrame = [&](OutputFrame &frame) {
+        frame.received = LedMapper::fromRealtime(frameStamps[frameIdx]);
+        frame.parsed = LedMapper::LatencyClock::now();
+        LM_PROBE2(frame_parsed, frameIdx, frameSizes[frameIdx]);
+    };
+
+    /// drain all queued datagrams of input at once
+    auto receiveBatch = [&](LedMapper::UdpManager &input, char *datagrams, int datagramSize) {
+        LedMapper::TraceScope scope(receiveTrace, "recv");
+        batched = input.ReceiveBatch(datagrams, datagramSize, frameSizes, MAX_FRAMES_BATCH, frameStamps);
+        scope.arg = batched;
+        if (batched > 0)
+            stats.add(LedMapper::Counter::DatagramsReceived, batched);
+        return batched > 0;
+    };
+
+    auto publishFrame = [&](size_t slot) {
+        LedMapper::TraceScope scope(receiveTrace, "publish", slot);
+        LM_PROBE1(frame_publish, slot);
+        stats.add(LedMapper::Counter::FramesParsed);
+        frameMailbox->back(slot).converted = LedMapper::LatencyClock::now();
+        /// previous frame was not taken by render thread and is dropped
+        if (!frameMailbox->publish(slot))
+            stats.add(LedMapper::Counter::FramesSkipped);
+        if (write(frameReadyFd, &wakeUp, sizeof(wakeUp)) != sizeof(wakeUp))
+            LOG_ASYNC(ERROR, "Failed to wake render thread");
+    };
+
+    loop.addTimer(FRAGMENT_TIMEOUT, [&](uint64_t) {
+        if (size_t expired = assembler.expire(FrameAssembler::Clock::now()))
+            LOG(DEBUG) << "Dropped incomplete fragmented frames=" << expired << " total=" << assembler.dropped()
+                       << " recovered fragments=" << assembler.recovered();
+        if (frameSequence.late() != reportedLateFrames) {
+            reportedLateFrames = frameSequence.late();
+            LOG(DEBUG) << "Dropped late frames total=" << reportedLateFrames << " lost=" << frameSequence.lost();
+        }
+    });
+
+    loop.add(frameInput.GetSocket(), [&]() {
+        if (!receiveBatch(frameInput, frames.data(), MAX_SENDBUFFER_SIZE))
+            return;
 
-        /// update output route based on atomic bool changed in typeListener thread
-        gpioSwitcher.switchWsOut(isWS.load(std::memory_order_acquire));
+        newestSingleIdx = -1;
+        if (RENDER_LATEST_FRAME_ONLY) {
+            /// latest frame wins: only newest valid single datagram frame of batch is converted,
+            /// newest by sequence when frames have it as sender may be reordered, else by position.
+            /// Fragments are never skipped as each of them is part of frame
+            uint32_t newestSequence = 0;
+            bool newestHasSequence = false;
+            for (frameIdx = 0; frameIdx < batched; ++frameIdx) {
+                message = frames.data() + frameIdx * MAX_SENDBUFFER_SIZE;
+                if (frameSizes[frameIdx] <= 4 || frameSizes[frameIdx] > (int)MAX_SENDBUFFER_SIZE
+                    || LedMapper::isFragment(message, frameSizes[frameIdx])
+                    || !frameView.parse(message, frameSizes[frameIdx]))
+                    continue;
+                if (newestSingleIdx >= 0 && newestHasSequence && frameView.hasSequence()
+                    && !LedMapper::sequenceNewer(frameView.sequence(), newestSequence))
+                    continue;
+                newestSingleIdx = frameIdx;
+                newestHasSequence = frameView.hasSequence();
+                newestSequence = frameView.sequence();
+            }
+        }
 
-        /// wait for frames with min size 4 bytes which are header
-        if ((received = frameInput.PeekReceive()) > 4) {
-            if (frameInput.Receive(message, received) <= 0)
+        for (frameIdx = 0; frameIdx < batched; ++frameIdx) {
+            /// wait for frames with min size 4 bytes which are header
+            if ((received = frameSizes[frameIdx]) <= 4)
+                continue;
+            if (received > MAX_SENDBUFFER_SIZE) {
+                LOG_ASYNC(WARNING, "Dropped truncated frame of size={}", received);
+                stats.add(LedMapper::Counter::FramesMalformed);
                 continue;
+            }
+            message = frames.data() + frameIdx * MAX_SENDBUFFER_SIZE;
 
-            chan_cntr = 0;
-            max_leds_in_chan = 0;
-            /// parse header to get number of leds to read per each channel
-            /// header end is sequence of two 0xff chars
-            while (chan_cntr + 1 < received && (message[chan_cntr * 2] != 0xff && message[chan_cntr * 2 + 1] != 0xff)) {
-                ledsInChannel[chan_cntr] = message[chan_cntr * 2 + 1] << 8 | message[chan_cntr * 2];
-                // LOG(DEBUG) << "chan #" << chan_cntr << "has leds=" << ledsInChannel[chan_cntr];
-                if (ledsInChannel[chan_cntr] > max_leds_in_chan)
-                    max_leds_in_chan = ledsInChannel[chan_cntr];
-                ++chan_cntr;
+            if (LedMapper::isFragment(message, received)) {
+                if (!LedMapper::readFragmentHeader(message, received, fragmentHeader)) {
+                    LOG_ASYNC(WARNING, "Dropped malformed fragment of size={}", received);
+                    stats.add(LedMapper::Counter::FramesMalformed);
+                    continue;
+                }
+                /// reject fragments of frames older than shown one before they take reassembly slot
+                if (LedMapper::hasSequence(fragmentHeader) && !frameSequence.accept(fragmentHeader.frameId))
+                    continue;
+                fragmentPayload = reinterpret_cast<const uint8_t *>(message) + sizeof(fragmentHeader);
+                fragmentPayloadSize = received - sizeof(fragmentHeader);
+                if ((fragmentSlot = assembler.add(fragmentHeader, fragmentPayload, fragmentPayloadSize,
+                                                  FrameAssembler::Clock::now()))
+                    < 0)
+                    continue;
+                OutputFrame &fragmentFrame = frameMailbox->back(fragmentSlot);
+                stampFrame(fragmentFrame);
+                {
+                    LedMapper::TraceScope scope(receiveTrace, "convert_fragment", fragmentHeader.fragIndex);
+                    /// parity fragments only carry frame layout, their payload stays in assembler
+                    parseFragment(fragmentHeader, fragmentPayload,
+                                  LedMapper::isParity(fragmentHeader) ? 0 : fragmentPayloadSize, isWS, fragmentFrame);
+                    if (assembler.recover(fragmentSlot, recoveredFragment))
+                        convertPixels(fragmentFrame, recoveredFragment.byteOffset / 3, recoveredFragment.payload,
+                                      recoveredFragment.size / 3);
+                }
+                if (assembler.isComplete(fragmentSlot)) {
+                    assembler.release(fragmentSlot);
+                    /// newer frame may have completed first
+                    if (LedMapper::hasSequence(fragmentHeader)) {
+                        if (!frameSequence.accept(fragmentHeader.frameId))
+                            continue;
+                        frameSequence.published(fragmentHeader.frameId);
+                    }
+                    publishFrame(fragmentSlot);
+                }
+                continue;
             }
 
-            headerByteOffset = chan_cntr * 2 + 2;
-            /// pixels pointer stores point to pixel data in message starting after offset
-            pixels = message + headerByteOffset;
+            if (!frameView.parse(message, received)) {
+                LOG_ASYNC(WARNING, "Dropped malformed frame of size={}", received);
+                stats.add(LedMapper::Counter::FramesMalformed);
+                continue;
+            }
+            if (newestSingleIdx >= 0 && frameIdx != newestSingleIdx) {
+                /// late frames are counted as late, rest as skipped and not as lost
+                if (frameView.hasSequence()) {
+                    if (!frameSequence.accept(frameView.sequence()))
+                        continue;
+                    frameSequence.skipped(frameView.sequence());
+                }
+                stats.add(LedMapper::Counter::FramesSkipped);
+                continue;
+            }
+            if (frameView.hasSequence()) {
+                if (!frameSequence.accept(frameView.sequence()))
+                    continue;
+                frameSequence.published(frameView.sequence());
+            }
+            stampFrame(frameMailbox->back(SINGLE_FRAME_SLOT));
+            {
+                LedMapper::TraceScope scope(receiveTrace, "convert_frame", frameView.channels());
+                parseFrame(frameView, isWS, frameMailbox->back(SINGLE_FRAME_SLOT));
+            }
+            publishFrame(SINGLE_FRAME_SLOT);
+        }
+    });
+
+    auto publishUniverses = [&](UniverseInput &input) {
+        OutputFrame &frame = *input.staging;
+        frame.channels = MAX_CHANNELS;
+        frame.maxLedsInChannel = 0;
+        for (size_t chan = 0; chan < MAX_CHANNELS; ++chan) {
+            frame.ledsInChannel[chan] = input.leds[chan];
+            frame.maxLedsInChannel = std::max<size_t>(frame.maxLedsInChannel, input.leds[chan]);
+        }
+        copyFrame(frame, frameMailbox->back(input.slot));
+        input.frame.published();
+        publishFrame(input.slot);
+    };
 
-            if (chan_cntr > MAX_CHANNELS)
-                chan_cntr = MAX_CHANNELS;
+    /// convert universe into input's staging frame, publish frame when it is latched
+    size_t universeChannel = 0, universeFirstLed = 0, universePixels = 0;
+    auto writeUniverse = [&](UniverseInput &input, uint16_t universe, const uint8_t *data, size_t length,
+                             LedMapper::UniverseFrame::Clock::time_point now) {
+        if (!input.frame.map(universe, universeChannel, universeFirstLed))
+            return;
+        /// without sync packets repeated universe means sender started next frame
+        if (input.frame.repeats(universe, now))
+            publishUniverses(input);
+        OutputFrame &frame = *input.staging;
+        stampFrame(frame);
+        frame.isWS = isWS;
+        universePixels = std::min<size_t>(length / 3, DMX_PIXELS_PER_UNIVERSE);
+        {
+            LedMapper::TraceScope scope(receiveTrace, "convert_universe", universe);
+            convertChannel(frame, universeChannel, universeFirstLed, data, universePixels);
+        }
+        input.leds[universeChannel] = std::max<size_t>(input.leds[universeChannel], universeFirstLed + universePixels);
+        if (input.frame.add(universe, now))
+            publishUniverses(input);
+    };
 
-            total_leds_num = (received - headerByteOffset) / 3;
+    UniverseInput artNet(artNetMapping, ARTNET_FRAME_SLOT, ARTNET_SYNC_TIMEOUT);
+    constexpr size_t ARTNET_DATAGRAM_SIZE = LedMapper::ARTNET_HEADER_SIZE + LedMapper::DMX_SLOTS;
+    std::vector<char> artNetDatagrams(MAX_FRAMES_BATCH * ARTNET_DATAGRAM_SIZE);
+    LedMapper::ArtDmx artDmx;
 
-            /// For each channel fill output buffers with pixels data
-            chanPixelOffset = 0;
-            for (curChannel = 0; curChannel < chan_cntr; ++curChannel) {
-                for (i = chanPixelOffset; i < ledsInChannel[curChannel] + chanPixelOffset && i < total_leds_num; ++i) {
+    if (artNetEnabled) {
+        loop.add(artNetInput.GetSocket(), [&]() {
+            if (!receiveBatch(artNetInput, artNetDatagrams.data(), ARTNET_DATAGRAM_SIZE))
+                return;
 
-                    // printf("%i : %i -> %d  %d  %d\n", curChannel, i - chanPixelOffset,
-                    //        pixels[i * 3 + 0], pixels[i * 3 + 1],
-                    //        pixels[i * 3 + 2]);
+            const auto now = LedMapper::UniverseFrame::Clock::now();
+            for (frameIdx = 0; frameIdx < batched; ++frameIdx) {
+                message = artNetDatagrams.data() + frameIdx * ARTNET_DATAGRAM_SIZE;
+                received = std::min<size_t>(frameSizes[frameIdx], ARTNET_DATAGRAM_SIZE);
 
-                    if (isWS && (i - chanPixelOffset) < LED_COUNT_WS) {
-                        wsOut.channel[curChannel].leds[i - chanPixelOffset]
-                            = (pixels[i * 3 + 0] << 16) | (pixels[i * 3 + 1] << 8) | pixels[i * 3 + 2];
-                    }
-                    else {
-                        spiOut.writeLed(curChannel, i - chanPixelOffset, pixels[i * 3 + 0], pixels[i * 3 + 1],
-                                        pixels[i * 3 + 2]);
-                    }
+                if (LedMapper::artNetOpCode(message, received) == LedMapper::ARTNET_OP_SYNC) {
+                    if (artNet.frame.sync(now))
+                        publishUniverses(artNet);
+                    continue;
                 }
-                chanPixelOffset += ledsInChannel[curChannel];
+                if (LedMapper::readArtDmx(message, received, artDmx))
+                    writeUniverse(artNet, artDmx.universe, artDmx.data, artDmx.length, now);
             }
+        });
+    }
+
+    UniverseInput sacn(sacnMapping, SACN_FRAME_SLOT, SACN_SYNC_TIMEOUT);
+    LedMapper::SacnSources sacnSources(SACN_SOURCE_TIMEOUT);
+    constexpr size_t SACN_DATAGRAM_SIZE = LedMapper::SACN_DATA_OFFSET + LedMapper::DMX_SLOTS;
+    std::vector<char> sacnDatagrams(MAX_FRAMES_BATCH * SACN_DATAGRAM_SIZE);
+    LedMapper::SacnDmx sacnDmx;
+    uint16_t sacnSyncUniverse = 0;
+
+    if (sacnEnabled) {
+        loop.add(sacnInput.GetSocket(), [&]() {
+            if (!receiveBatch(sacnInput, sacnDatagrams.data(), SACN_DATAGRAM_SIZE))
+                return;
 
-            if (isWS) {
-                wsReturnStat = ws2811_render(&wsOut);
-                if (wsReturnStat != WS2811_SUCCESS) {
-                    LOG(ERROR) << "ws2811_render failed: " << ws2811_get_return_t_str(wsReturnStat);
-                    break;
+            const auto now = LedMapper::UniverseFrame::Clock::now();
+            for (frameIdx = 0; frameIdx < batched; ++frameIdx) {
+                message = sacnDatagrams.data() + frameIdx * SACN_DATAGRAM_SIZE;
+                received = std::min<size_t>(frameSizes[frameIdx], SACN_DATAGRAM_SIZE);
+
+                if (uint16_t syncUniverse = LedMapper::readSacnSync(message, received)) {
+                    if (syncUniverse == sacnSyncUniverse && sacn.frame.sync(now))
+                        publishUniverses(sacn);
+                    continue;
+                }
+                /// preview data is meant for visualizers, not for fixtures
+                if (!LedMapper::readSacnDmx(message, received, sacnDmx)
+                    || (sacnDmx.options & LedMapper::SACN_OPTION_PREVIEW) || sacnDmx.universe < SACN_FIRST_UNIVERSE
+                    || size_t(sacnDmx.universe - SACN_FIRST_UNIVERSE) >= sacnMapping.universes()
+                    || !sacnSources.accept(sacnDmx.universe - SACN_FIRST_UNIVERSE, sacnDmx, now))
+                    continue;
+                /// sync packets go to multicast group of sync universe, join it once sender announces it
+                if (sacnDmx.syncUniverse && sacnDmx.syncUniverse != sacnSyncUniverse) {
+                    sacnSyncUniverse = sacnDmx.syncUniverse;
+                    LedMapper::sacnMulticastAddress(sacnSyncUniverse, sacnGroup);
+                    if (!sacnInput.JoinMcast(sacnGroup))
+                        LOG(WARNING) << "Failed to join sACN sync universe=" << sacnSyncUniverse;
                 }
-                // LOG(DEBUG) << "leds send:" << ledsInChannel[0];
+                writeUniverse(sacn, sacnDmx.universe, sacnDmx.data, sacnDmx.length, now);
             }
-            else {
-                for (curChannel = 0; curChannel < chan_cntr; ++curChannel) {
-                    if (ledsInChannel[curChannel] == 0)
-                        continue;
-                    digitalWrite(PIN_SWITCH_SPI, curChannel == 0 ? HIGH : LOW);
-                    spiOut.send(curChannel, ledsInChannel[curChannel]);
+        });
+    }
+
+    /// DDP payloads are converted into staging frame at their offset, so pixels not resent are kept,
+    /// it is copied into DDP mailbox slot on push. Channel leds count is the furthest led any payload
+    /// reached so far as for DMX universes
+    LedMapper::DdpPacket ddpPacket;
+    auto ddpStaging = std::make_unique<OutputFrame>();
+    uint16_t ddpLeds[MAX_CHANNELS] = {};
+    size_t ddpPixel = 0, ddpPixels = 0, ddpChannel = 0, ddpChannelPixels = 0;
+
+    if (ddpEnabled) {
+        loop.add(ddpInput.GetSocket(), [&]() {
+            if (!receiveBatch(ddpInput, frames.data(), MAX_SENDBUFFER_SIZE))
+                return;
+
+            for (frameIdx = 0; frameIdx < batched; ++frameIdx) {
+                message = frames.data() + frameIdx * MAX_SENDBUFFER_SIZE;
+                received = std::min<size_t>(frameSizes[frameIdx], MAX_SENDBUFFER_SIZE);
+                if (!LedMapper::readDdp(message, received, ddpPacket) || (ddpPacket.flags & LedMapper::DDP_FLAG_QUERY)
+                    || (ddpPacket.destination != LedMapper::DDP_ID_DISPLAY
+                        && ddpPacket.destination != LedMapper::DDP_ID_ALL))
+                    continue;
+                if (!LedMapper::isDdpRgb24(ddpPacket.dataType) || ddpPacket.offset % 3 != 0) {
+                    LOG_ASYNC(WARNING, "Dropped DDP packet with data type={} offset={}", ddpPacket.dataType,
+                              ddpPacket.offset);
+                    stats.add(LedMapper::Counter::FramesMalformed);
+                    continue;
+                }
+
+                OutputFrame &frame = *ddpStaging;
+                stampFrame(frame);
+                frame.isWS = isWS;
+                LedMapper::TraceScope scope(receiveTrace, "convert_ddp", ddpPacket.offset / 3);
+                /// payload may cross channel border
+                ddpPixel = ddpPacket.offset / 3;
+                ddpPixels = ddpPacket.length / 3;
+                const uint8_t *rgb = ddpPacket.data;
+                while (ddpPixels > 0 && (ddpChannel = ddpPixel / DDP_LEDS_PER_CHANNEL) < MAX_CHANNELS) {
+                    ddpChannelPixels = std::min(ddpPixels, DDP_LEDS_PER_CHANNEL - ddpPixel % DDP_LEDS_PER_CHANNEL);
+                    convertChannel(frame, ddpChannel, ddpPixel % DDP_LEDS_PER_CHANNEL, rgb, ddpChannelPixels);
+                    ddpLeds[ddpChannel] = std::max<size_t>(ddpLeds[ddpChannel],
+                                                           ddpPixel % DDP_LEDS_PER_CHANNEL + ddpChannelPixels);
+                    ddpPixel += ddpChannelPixels;
+                    ddpPixels -= ddpChannelPixels;
+                    rgb += ddpChannelPixels * 3;
+                }
+
+                if (ddpPacket.flags & LedMapper::DDP_FLAG_PUSH) {
+                    frame.channels = MAX_CHANNELS;
+                    frame.maxLedsInChannel = 0;
+                    for (size_t chan = 0; chan < MAX_CHANNELS; ++chan) {
+                        frame.ledsInChannel[chan] = ddpLeds[chan];
+                        frame.maxLedsInChannel = std::max<size_t>(frame.maxLedsInChannel, ddpLeds[chan]);
+                    }
+                    copyFrame(frame, frameMailbox->back(DDP_FRAME_SLOT));
+                    publishFrame(DDP_FRAME_SLOT);
                 }
-                std::this_thread::sleep_for(microseconds(max_leds_in_chan));
             }
-        }
+        });
     }
 
+    /// copy counters kept by sockets and frame bookkeeping into pipeline stats
+    auto updateStats = [&]() {
+        stats.set(LedMapper::Counter::KernelDrops,
+                  uint64_t(frameInput.GetKernelDrops()) + artNetInput.GetKernelDrops() + ddpInput.GetKernelDrops()
+                      + sacnInput.GetKernelDrops());
+        stats.set(LedMapper::Counter::FramesLate, frameSequence.late());
+        stats.set(LedMapper::Counter::FramesLost, frameSequence.lost());
+        stats.set(LedMapper::Counter::FragmentsRecovered, assembler.recovered());
+        stats.set(LedMapper::Counter::FragmentedFramesDropped, assembler.dropped());
+    };
+
+    loop.addTimer(STATS_LOG_PERIOD, [&](uint64_t) {
+        updateStats();
+        std::ostringstream line;
+        for (size_t i = 0; i < LedMapper::PipelineStats::SIZE; ++i) {
+            const auto counter = static_cast<LedMapper::Counter>(i);
+            line << " " << LedMapper::PipelineStats::name(counter) << "=" << stats.get(counter);
+        }
+        LOG(INFO) << "Stats:" << line.str();
+        line.str("");
+        for (size_t i = 0; i < LedMapper::LatencyStats::SIZE; ++i) {
+            const auto stage = static_cast<LedMapper::LatencyStage>(i);
+            line << " " << LedMapper::LatencyStats::name(stage) << "=" << latency[stage].percentile(0.5) << "/"
+                 << latency[stage].percentile(0.99) << "/" << latency[stage].percentile(0.999);
+        }
+        LOG(INFO) << "Latency p50/p99/p99.9 us:" << line.str();
+    });
+
+    LedMapper::MetricsServer metrics(loop, [&](std::ostream &out) {
+        updateStats();
+        LedMapper::writeMetrics(out, stats);
+        LedMapper::writeMetrics(out, latency);
+        LedMapper::writeProcessMetrics(out);
+    });
+    if (METRICS_PORT && !metrics.listen(METRICS_PORT))
+        LOG(WARNING) << "Failed to listen on metrics port=" << METRICS_PORT << ", metrics disabled";
+#endif
+
+    LOG(INFO) << "Inited ledMapper Listener";
+
+    /// blocks until signal or output failure stops the loop
+    loop.run();
+
     LOG(INFO) << "Exit from loop";
 
-    if (typeListener.joinable())
-        typeListener.join();
+    continue_looping.store(false);
+    if (write(frameReadyFd, &wakeUp, sizeof(wakeUp)) != sizeof(wakeUp))
+        LOG(ERROR) << "Failed to wake render thread";
+    if (renderer.joinable())
+        renderer.join();
+    if (traceFile)
+        dumpTrace();
+    LedMapper::AsyncLog::instance().stop();
+    close(frameReadyFd);
 
-    ws2811_fini(&wsOut);
+    wsOut.fini();
 
     return 0;
 }
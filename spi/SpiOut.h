@@ -1,8 +1,13 @@
+#pragma once
+
+#include <algorithm>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include "sk9822led.h"
+#include "../AsyncLog.h"
+#include "../PixelConvert.h"
 #include "../easylogging++.h"
 
 struct SpiOut
@@ -46,8 +51,8 @@ struct SpiOut
     }
 
     void writeLed(size_t chan, size_t index, uint8_t red, uint8_t green, uint8_t blue) {
-        if (chan > buffers.size() || index > buffers[chan].leds) {
-            LOG(ERROR) << "SPI writeLed out of range chan=" << chan << " index=" << index;
+        if (chan >= buffers.size() || index >= buffers[chan].leds) {
+            LOG_ASYNC(ERROR, "SPI writeLed out of range chan={} index={}", chan, index);
             return;
         }
         auto &buf = buffers[chan];
@@ -57,11 +62,43 @@ struct SpiOut
         buf.pixels[index].b = blue;
     }
 
-    void send(size_t chan, size_t ledsNumber){
+    /// write count packed RGB pixels starting from led offset in one pass
+    void writeSpan(size_t chan, size_t offset, const uint8_t *rgb, size_t count) {
+        if (chan >= buffers.size() || offset >= buffers[chan].leds) {
+            LOG_ASYNC(ERROR, "SPI writeSpan out of range chan={} offset={}", chan, offset);
+            return;
+        }
+        writeSpan(buffers[chan], offset, rgb, count);
+    }
+
+    /// write into externally owned buffer, e.g. slot of frame mailbox, count is clamped to buffer size
+    static void writeSpan(sk9822_buffer &buf, size_t offset, const uint8_t *rgb, size_t count) {
+        if (offset >= buf.leds)
+            return;
+        LedMapper::rgb24ToSk9822(rgb, reinterpret_cast<uint8_t *>(buf.pixels + offset),
+                                 std::min(count, buf.leds - offset));
+    }
+
+    /// send own buffer of channel, returns false if channel is wrong or write failed
+    bool send(size_t chan, size_t ledsNumber){
         if (fd < 0 || chan >= buffers.size()) {
-            LOG(ERROR) << "SPI not initialized or wrong channel:" << chan;
+            LOG_ASYNC(ERROR, "SPI not initialized or wrong channel:{}", chan);
+            return false;
         }
-        send_buffer(fd, &buffers[chan], ledsNumber);
+        return send(buffers[chan], ledsNumber);
+    }
+
+    /// send externally owned buffer, e.g. slot of frame mailbox, returns false if write failed
+    bool send(sk9822_buffer &buf, size_t ledsNumber){
+        if (fd < 0) {
+            LOG_ASYNC(ERROR, "SPI not initialized");
+            return false;
+        }
+        if (send_buffer(fd, &buf, ledsNumber) < 0) {
+            LOG_ASYNC(ERROR, "SPI write failed: errno={}", errno);
+            return false;
+        }
+        return true;
     }
 
     int fd;
@@ -10,16 +10,19 @@
 /// sudo gcc ./sk9822led.c ./udp_listen.c sk9822led.h -o udpSK98 -lm
 
 #include "sk9822led.h"
+#include "../Probes.h"
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/spi/spidev.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 void write_frame(sk9822_color *p, uint8_t red, uint8_t green, uint8_t blue);
 void write_raw(sk9822_color *p, sk9822_color color);
+void write_end_frame(sk9822_buffer *buf, int leds_num);
 uint8_t make_flag(uint8_t red, uint8_t greem, uint8_t blue);
 ssize_t write_all(int filedes, const void *buf, size_t size);
 
@@ -52,6 +55,9 @@ int sk9822_init(sk9822_buffer *buf, int leds)
     endFrame.b = 0x00;
     endFrame.f = 0x00;
 
+    /// start frame is precomputed, send_buffer rewrites end frame after sent leds only
+    write_raw(buf->buffer, startFrame);
+
     return 0;
 }
 
@@ -89,16 +95,19 @@ void write_color(sk9822_color *p, uint8_t red, uint8_t green, uint8_t blue)
     write_frame(p, red, green, blue);
 }
 
-int send_buffer(int filedes, sk9822_buffer *buf, const int leds_num)
+int send_buffer(int filedes, sk9822_buffer *buf, int leds_num)
 {
     int ret;
-    write_raw(buf->buffer, startFrame);
-    // write endFrame + zero bit for each second led with 32 leds step (==sizeof(sk9822_color))
+    if (leds_num > (int)buf->leds)
+        leds_num = (int)buf->leds;
+    /// end frame takes place of pixels past leds_num, which may get new pixels between sends,
+    /// so it is rewritten on every send, that is few words only
+    write_end_frame(buf, leds_num);
     int endFramesSize = 2 + (leds_num-1) / 64;
-    for (int i=0; i < endFramesSize; ++i)
-        write_raw(buf->pixels + leds_num + i, endFrame);
 
+    LM_PROBE2(spi_send_start, filedes, leds_num);
     ret = (int)write_all(filedes, buf->buffer, (leds_num + 1 + endFramesSize) * sizeof(sk9822_color));
+    LM_PROBE2(spi_send_done, filedes, ret);
     return ret;
 }
 
@@ -117,6 +126,14 @@ void write_raw(sk9822_color *p, sk9822_color color)
     p->b = color.b;
     // printf ("raw:  %02x , %02x \n", p->rg & 255, p->gb & 255);
 }
+void write_end_frame(sk9822_buffer *buf, int leds_num)
+{
+    // write endFrame + zero bit for each second led with 32 leds step (==sizeof(sk9822_color))
+    int endFramesSize = 2 + (leds_num-1) / 64;
+    for (int i=0; i < endFramesSize; ++i)
+        write_raw(buf->pixels + leds_num + i, endFrame);
+}
+
 void write_frame(sk9822_color *p, uint8_t red, uint8_t green, uint8_t blue)
 {
     p->f = 255;
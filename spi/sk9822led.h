@@ -88,6 +88,9 @@ void write_color(sk9822_color *p, const uint8_t red, const uint8_t green, const
  * int filedes - The open and initialized file descriptor for the spi device.
  * sk9822_buffer *buf - A pointer to a sk9822_buffer which will be transferred to spi.
  *
+ * The start frame is written once by sk9822_init, the end frame is written
+ * after leds_num pixels on every call, as pixels past it may be rewritten.
+ *
  * This function returns the number of bytes written if successful or a
  * negative number if it fails. This function will always block while writing
  * and ensure all data is transferred out to the SPI bus.
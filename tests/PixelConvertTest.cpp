@@ -0,0 +1,74 @@
+//
+// Checks vectorized converters of PixelConvert.h against scalar references for every length 0..MAX_LEDS,
+// so all tails which are not a multiple of vector width are covered. Build and run with make test.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../PixelConvert.h"
+
+namespace {
+
+constexpr size_t MAX_LEDS = 100;
+constexpr uint8_t GUARD = 0xA5; // output bytes past count must stay untouched
+
+/// fill rgb with pseudo random bytes, all 256 values are hit
+void fill(std::vector<uint8_t> &rgb, unsigned seed)
+{
+    srand(seed);
+    for (auto &byte : rgb)
+        byte = static_cast<uint8_t>(rand());
+}
+
+bool checkWs(const std::vector<uint8_t> &rgb, size_t count)
+{
+    std::vector<uint32_t> simd(count + 4), scalar(count + 4);
+    memset(simd.data(), GUARD, simd.size() * sizeof(uint32_t));
+    memset(scalar.data(), GUARD, scalar.size() * sizeof(uint32_t));
+    LedMapper::rgb24ToWs(rgb.data(), simd.data(), count);
+    LedMapper::rgb24ToWsScalar(rgb.data(), scalar.data(), count);
+    if (simd != scalar) {
+        fprintf(stderr, "rgb24ToWs differs from scalar for count=%zu\n", count);
+        return false;
+    }
+    return true;
+}
+
+bool checkSk9822(const std::vector<uint8_t> &rgb, size_t count)
+{
+    std::vector<uint8_t> simd((count + 4) * 4, GUARD), scalar((count + 4) * 4, GUARD);
+    LedMapper::rgb24ToSk9822(rgb.data(), simd.data(), count);
+    LedMapper::rgb24ToSk9822Scalar(rgb.data(), scalar.data(), count);
+    if (simd != scalar) {
+        fprintf(stderr, "rgb24ToSk9822 differs from scalar for count=%zu\n", count);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+#if defined(LM_PIXEL_NEON)
+    printf("PixelConvert: NEON kernels\n");
+#elif defined(LM_PIXEL_SSSE3)
+    printf("PixelConvert: SSSE3 kernels\n");
+#else
+    printf("PixelConvert: scalar only, build with SIMD_FLAGS to test vector kernels\n");
+#endif
+    bool ok = true;
+    for (size_t count = 0; count <= MAX_LEDS; ++count) {
+        /// exact size input, so reads past the last pixel are caught by sanitizers
+        std::vector<uint8_t> rgb(count * 3);
+        fill(rgb, static_cast<unsigned>(count));
+        ok = checkWs(rgb, count) && ok;
+        ok = checkSk9822(rgb, count) && ok;
+    }
+    printf("PixelConvert: %s for counts 0..%zu\n", ok ? "OK" : "FAILED", MAX_LEDS);
+    return ok ? 0 : 1;
+}